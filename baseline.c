@@ -0,0 +1,176 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "baseline.h"
+
+int bench_cmp_long(const void *a, const void *b)
+{
+    long x = *(const long *) a, y = *(const long *) b;
+    return (x > y) - (x < y);
+}
+
+static int cmp_llong(const void *a, const void *b)
+{
+    long long x = *(const long long *) a, y = *(const long long *) b;
+    return (x > y) - (x < y);
+}
+
+void bench_summarize(bench_case_t *c, long *ns, size_t runs)
+{
+    c->runs = runs;
+    if (!runs) {
+        c->median = c->ci_lo = c->ci_hi = -1;
+        return;
+    }
+    qsort(ns, runs, sizeof(*ns), bench_cmp_long);
+    c->median = runs & 1 ? ns[runs / 2]
+                         : (ns[runs / 2 - 1] + ns[runs / 2]) / 2;
+
+    /*
+     * Ranks n/2 -+ 1.96 sqrt(n)/2 bound the median with ~95% confidence
+     * (normal approximation of the binomial), the full range below 6 runs.
+     */
+    double half = 1.96 * sqrt((double) runs) / 2;
+    long lo = (long) floor(runs / 2.0 - half);
+    long hi = (long) ceil(runs / 2.0 + half);
+    if (runs < 6 || lo < 0)
+        lo = 0;
+    if (runs < 6 || hi > (long) runs - 1)
+        hi = runs - 1;
+    c->ci_lo = ns[lo];
+    c->ci_hi = ns[hi];
+}
+
+long bench_percentile(const long *sorted, size_t n, unsigned permille)
+{
+    /* need at least one sample above the rank, except for the max */
+    if (!n || (permille < 1000 && n * (1000 - permille) < 1000))
+        return -1;
+    return sorted[(permille * n + 999) / 1000 - 1];
+}
+
+long long bench_median_count(long long *v, size_t n)
+{
+    if (!n)
+        return -1;
+    qsort(v, n, sizeof(*v), cmp_llong);
+    return v[0] < 0 ? -1 : v[n / 2];
+}
+
+static bool same_case(const bench_case_t *a, const bench_case_t *b)
+{
+    return a->n == b->n && !strcmp(a->engine, b->engine) &&
+           !strcmp(a->dist, b->dist) && !strcmp(a->pages, b->pages) &&
+           !strcmp(a->config, b->config);
+}
+
+static void write_case(FILE *f, const bench_case_t *c)
+{
+    fprintf(f, "%s %s %zu %s %s %zu %ld %ld %ld %lld %lld\n", c->engine,
+            c->dist, c->n, c->pages, c->config, c->runs, c->median, c->ci_lo,
+            c->ci_hi, c->cmp, c->branch_misses);
+}
+
+long baseline_load(const char *path, bench_case_t **cases)
+{
+    FILE *f = fopen(path, "r");
+    char line[512];
+    size_t n = 0, cap = 0;
+
+    *cases = NULL;
+    if (!f)
+        return -1;
+    while (fgets(line, sizeof(line), f)) {
+        bench_case_t c;
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+        if (sscanf(line, "%31s %31s %zu %31s %31s %zu %ld %ld %ld %lld %lld",
+                   c.engine, c.dist, &c.n, c.pages, c.config, &c.runs,
+                   &c.median, &c.ci_lo, &c.ci_hi, &c.cmp,
+                   &c.branch_misses) != 11) {
+            fprintf(stderr, "%s: bad line: %s", path, line);
+            continue;
+        }
+        if (n == cap) {
+            cap = cap ? 2 * cap : 16;
+            bench_case_t *grown = realloc(*cases, cap * sizeof(bench_case_t));
+            if (!grown) {
+                free(*cases);
+                *cases = NULL;
+                fclose(f);
+                return -1;
+            }
+            *cases = grown;
+        }
+        (*cases)[n++] = c;
+    }
+    fclose(f);
+    return n;
+}
+
+int baseline_save(const char *path, const bench_case_t *cases, size_t n)
+{
+    bench_case_t *old;
+    long nold = baseline_load(path, &old);
+    FILE *f = fopen(path, "w");
+
+    if (!f) {
+        free(old);
+        return -1;
+    }
+    fprintf(f, "# engine dist n pages config runs median_ns ci_lo_ns "
+               "ci_hi_ns cmp branch_misses\n");
+    for (long i = 0; i < nold; i++) {
+        size_t k;
+        for (k = 0; k < n && !same_case(&old[i], &cases[k]); k++)
+            ;
+        if (k == n)
+            write_case(f, &old[i]);
+    }
+    for (size_t k = 0; k < n; k++)
+        write_case(f, &cases[k]);
+    free(old);
+    return fclose(f) ? -1 : 0;
+}
+
+int baseline_compare(const bench_case_t *base, size_t nbase,
+                     const bench_case_t *cur, size_t ncur, double threshold,
+                     FILE *out)
+{
+    int regressions = 0;
+
+    for (size_t k = 0; k < ncur; k++) {
+        const bench_case_t *c = &cur[k], *b = NULL;
+        for (size_t i = 0; i < nbase && !b; i++)
+            if (same_case(&base[i], c))
+                b = &base[i];
+
+        fprintf(out, "%-10s %-8s %9zu %-6s %-14s ", c->engine, c->dist, c->n,
+                c->pages, c->config);
+        if (!b) {
+            fprintf(out, "no baseline\n");
+            continue;
+        }
+
+        double change = 100.0 * (c->median - b->median) / b->median;
+        const char *verdict = "same";
+        if (c->ci_lo > b->ci_hi) {
+            verdict = change > threshold ? "REGRESSION" : "slower";
+            regressions += change > threshold;
+        } else if (c->ci_hi < b->ci_lo) {
+            verdict = "improved";
+        }
+        fprintf(out, "%ld -> %ld ns (%+.1f%%) %s", b->median, c->median,
+                change, verdict);
+        if (b->cmp >= 0 && c->cmp >= 0 && b->cmp != c->cmp)
+            fprintf(out, ", cmp %lld -> %lld", b->cmp, c->cmp);
+        if (b->branch_misses > 0 && c->branch_misses >= 0)
+            fprintf(out, ", branch misses %+.1f%%",
+                    100.0 * (c->branch_misses - b->branch_misses) /
+                        b->branch_misses);
+        fprintf(out, "\n");
+    }
+    return regressions;
+}
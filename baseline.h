@@ -0,0 +1,67 @@
+/*
+ * Benchmark baselines: per case summaries that a run can save and a later
+ * run can compare against.
+ *
+ * A case is one engine on one input (distribution, size, node backing and
+ * sort knobs). It is summarized by the median time over the runs with a
+ * ~95% confidence interval of that median (order statistics, no normality
+ * assumption) plus the median of the deterministic counters.
+ *
+ * The file is plain text, one case per line:
+ *
+ *   engine dist n pages config runs median_ns ci_lo_ns ci_hi_ns cmp
+ *   branch_misses
+ *
+ * with -1 for counters the build or the machine could not measure. Lines
+ * starting with '#' are comments.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdio.h>
+
+#define BENCH_NAME 32
+
+typedef struct {
+    char engine[BENCH_NAME], dist[BENCH_NAME], pages[BENCH_NAME];
+    char config[BENCH_NAME];
+    size_t n, runs;
+    long median, ci_lo, ci_hi;          /* ns */
+    long long cmp, branch_misses;       /* medians, -1 if not measured */
+} bench_case_t;
+
+/* qsort comparator for long samples */
+int bench_cmp_long(const void *a, const void *b);
+
+/*
+ * Nearest rank percentile (permille / 10 %) of "n" ascending samples, -1
+ * when there are too few of them for it to differ from the maximum, e.g.
+ * fewer than 1000 for p99.9.
+ */
+long bench_percentile(const long *sorted, size_t n, unsigned permille);
+
+/* Fill median and confidence interval from "runs" samples, sorts "ns" */
+void bench_summarize(bench_case_t *c, long *ns, size_t runs);
+
+/* Median of "n" counters, sorts "v", -1 if any of them is -1 */
+long long bench_median_count(long long *v, size_t n);
+
+/* Read a baseline file, returns the number of cases, -1 on error */
+long baseline_load(const char *path, bench_case_t **cases);
+
+/*
+ * Merge "n" cases into the file at "path": cases already there with the
+ * same key are replaced, the others kept. Returns 0 or -1 on error.
+ */
+int baseline_save(const char *path, const bench_case_t *cases, size_t n);
+
+/*
+ * Print one verdict per current case found in the baseline. A change is
+ * significant when the two confidence intervals do not overlap; it counts
+ * as a regression when it is also more than "threshold" percent slower.
+ * Returns the number of regressions.
+ */
+int baseline_compare(const bench_case_t *base, size_t nbase,
+                     const bench_case_t *cur, size_t ncur, double threshold,
+                     FILE *out);
@@ -0,0 +1,426 @@
+/*
+ * c_map microbenchmarks: the primitives of one backend measured on their
+ * own, in ns/op plus per-op hardware counters.
+ *
+ * The backend source is included directly so its static helpers
+ * (rotations, color fixing, calibration) can be called:
+ *
+ *   gcc -O2 -o bench_cmap bench_cmap.c perf_counter.c
+ *   gcc -O2 -DC_MAP_PLAIN -o bench_cmap bench_cmap.c perf_counter.c
+ *
+ * Prints one line per benchmark: name backend n ops ns/op cycles/op
+ * instructions/op branch_misses/op cache_misses/op, each the median over
+ * the -t repeats, "-" for counters the machine does not provide.
+ *
+ * Batch benchmarks time a whole loop of operations. fix_colors has to
+ * descend and attach the node first, so it is timed per call inside a
+ * window; the cost of an empty window is measured up front and taken off.
+ */
+
+#ifdef C_MAP_PLAIN
+#include "c_map.c"
+#define BACKEND "plain"
+#define PARENT(n) ((n)->up)
+#define SET_PARENT(n, p) ((n)->up = (p))
+#define RAW_PARENT(n) ((n)->up)
+#define RAW_SET_PARENT(n, p) ((n)->up = (p))
+#else
+#include "c_map_bit.c"
+#define BACKEND "bit"
+#define PARENT(n) rb_parent(n)
+#define SET_PARENT(n, p) rb_set_parent(n, p)
+/* the same field without the color bit handling */
+#define RAW_PARENT(n) ((node_t *) (n)->color)
+#define RAW_SET_PARENT(n, p) ((n)->color = (unsigned long) (p))
+#endif
+
+#include <time.h>
+#include <unistd.h>
+
+#include "perf_counter.h"
+
+#define NEVENTS 4
+#define MAX_REPEATS 64
+
+static const uint64_t events[NEVENTS] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_BRANCH_MISSES,
+    PERF_COUNT_HW_CACHE_MISSES,
+};
+
+static perf_counter_t counter[NEVENTS];
+
+/* Time and events summed over the windows of one repeat */
+struct sample {
+    double ns;
+    double ev[NEVENTS];
+};
+
+static struct sample cur, window_cost;
+static struct timespec window_start;
+
+static void sample_begin(void)
+{
+    cur = (struct sample){ 0 };
+    for (int k = 0; k < NEVENTS; k++) {
+        perf_counter_start(counter[k]);
+        perf_counter_pause(counter[k]);
+    }
+}
+
+static void sample_end(void)
+{
+    for (int k = 0; k < NEVENTS; k++)
+        cur.ev[k] = perf_counter_stop(counter[k]);
+}
+
+static inline void window_open(void)
+{
+    for (int k = 0; k < NEVENTS; k++)
+        perf_counter_resume(counter[k]);
+    clock_gettime(CLOCK_MONOTONIC, &window_start);
+}
+
+static inline void window_close(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    for (int k = 0; k < NEVENTS; k++)
+        perf_counter_pause(counter[k]);
+    cur.ns += (t.tv_sec - window_start.tv_sec) * 1e9 +
+              (t.tv_nsec - window_start.tv_nsec);
+}
+
+static volatile uintptr_t sink;
+static node_t *nodes;
+
+typedef enum { KEYS_RANDOM, KEYS_ASCENDING, KEYS_DESCENDING } keys_t;
+
+/* nodes[0 .. n) with keys 0 .. n - 1 in the given order, chained by next */
+static void make_keys(size_t n, keys_t order)
+{
+    for (size_t i = 0; i < n; i++) {
+        nodes[i] = (node_t){ 0 };
+        nodes[i].value = order == KEYS_DESCENDING ? (long) (n - 1 - i) : i;
+    }
+    for (size_t i = 0; order == KEYS_RANDOM && n > 1 && i < n - 1; i++) {
+        size_t j = i + rand() / (RAND_MAX / (n - i) + 1);
+        long t = nodes[j].value;
+        nodes[j].value = nodes[i].value;
+        nodes[i].value = t;
+    }
+    for (size_t i = 0; i < n; i++)
+        nodes[i].next = i + 1 < n ? &nodes[i + 1] : NULL;
+}
+
+static c_map_t map_new(void)
+{
+    return c_map_new(sizeof(long), sizeof(NULL), c_map_cmp_long);
+}
+
+/* Map of shuffled keys built by insertion, node order != key order */
+static c_map_t map_random(size_t n)
+{
+    c_map_t map = map_new();
+    make_keys(n, KEYS_RANDOM);
+    for (size_t i = 0; i < n; i++)
+        c_map_insert(map, &nodes[i], NULL);
+    return map;
+}
+
+static size_t insert_keys(size_t n, keys_t order)
+{
+    c_map_t map = map_new();
+    make_keys(n, order);
+    window_open();
+    for (size_t i = 0; i < n; i++)
+        c_map_insert(map, &nodes[i], NULL);
+    window_close();
+    c_map_delete(map);
+    return n;
+}
+
+static size_t bench_insert_random(size_t n)
+{
+    return insert_keys(n, KEYS_RANDOM);
+}
+
+static size_t bench_insert_asc(size_t n)
+{
+    return insert_keys(n, KEYS_ASCENDING);
+}
+
+static size_t bench_insert_desc(size_t n)
+{
+    return insert_keys(n, KEYS_DESCENDING);
+}
+
+/*
+ * Left rotation at every node that has a right child, in random order,
+ * then the right rotation that undoes it
+ */
+static size_t bench_rotate(size_t n)
+{
+    c_map_t map = map_random(n);
+    node_t **at = malloc(sizeof(node_t *) * (n ? n : 1));
+    size_t m = 0;
+
+    for (size_t i = 0; i < n; i++)
+        if (nodes[i].right)
+            at[m++] = &nodes[i];
+    for (size_t i = 0; m > 1 && i < m - 1; i++) {
+        size_t j = i + rand() / (RAND_MAX / (m - i) + 1);
+        node_t *t = at[j];
+        at[j] = at[i];
+        at[i] = t;
+    }
+    window_open();
+    for (size_t i = 0; i < m; i++)
+        c_map_rotate_right(map, c_map_rotate_left(map, at[i]));
+    window_close();
+    free(at);
+    c_map_delete(map);
+    return 2 * m;
+}
+
+/* c_map_insert minus the calibration, only c_map_fix_colors is timed */
+static size_t bench_fix_colors(size_t n)
+{
+    c_map_t map = map_new();
+
+    make_keys(n, KEYS_RANDOM);
+    for (size_t i = 0; i < n; i++) {
+        node_t *node = &nodes[i], *up = map->head;
+        c_map_create_node(node);
+        if (!up) {
+            map->head = node;
+            c_map_fix_colors(map, node);    /* a black root */
+            continue;
+        }
+        for (;;) {
+            node_t **link = node->value < up->value ? &up->left : &up->right;
+            if (!*link) {
+                *link = node;
+                SET_PARENT(node, up);
+                break;
+            }
+            up = *link;
+        }
+        window_open();
+        c_map_fix_colors(map, node);
+        window_close();
+    }
+    c_map_delete(map);
+    return n ? n - 1 : 0;
+}
+
+static size_t bench_calibrate(size_t n)
+{
+    c_map_t map = map_random(n);
+
+    window_open();
+    for (size_t i = 0; i < n; i++)
+        c_map_calibrate(map);
+    window_close();
+    c_map_delete(map);
+    return n;
+}
+
+/* c_map_first and n - 1 c_map_next */
+static size_t bench_traverse(size_t n)
+{
+    c_map_t map = map_random(n);
+    uintptr_t sum = 0;
+
+    window_open();
+    for (node_t *node = c_map_first(map); node; node = c_map_next(node))
+        sum += node->value;
+    window_close();
+    sink = sum;
+    c_map_delete(map);
+    return n;
+}
+
+static size_t bench_parent_get(size_t n)
+{
+    c_map_t map = map_random(n);
+    uintptr_t sum = 0;
+
+    window_open();
+    for (size_t i = 0; i < n; i++)
+        sum += (uintptr_t) PARENT(&nodes[i]);
+    window_close();
+    sink = sum;
+    c_map_delete(map);
+    return n;
+}
+
+static size_t bench_parent_get_raw(size_t n)
+{
+    c_map_t map = map_random(n);
+    uintptr_t sum = 0;
+
+    window_open();
+    for (size_t i = 0; i < n; i++)
+        sum += (uintptr_t) RAW_PARENT(&nodes[i]);
+    window_close();
+    sink = sum;
+    c_map_delete(map);
+    return n;
+}
+
+static size_t bench_parent_set(size_t n)
+{
+    c_map_t map = map_random(n);
+
+    window_open();
+    for (size_t i = 0; i < n; i++)
+        SET_PARENT(&nodes[i], &nodes[n - 1 - i]);
+    window_close();
+    c_map_delete(map);
+    return n;
+}
+
+static size_t bench_parent_set_raw(size_t n)
+{
+    c_map_t map = map_random(n);
+
+    window_open();
+    for (size_t i = 0; i < n; i++)
+        RAW_SET_PARENT(&nodes[i], &nodes[n - 1 - i]);
+    window_close();
+    c_map_delete(map);
+    return n;
+}
+
+static const struct {
+    const char *name;
+    size_t (*run)(size_t n);
+    bool windowed;      /* one window per op, empty window cost taken off */
+} benches[] = {
+    { "insert_rand", bench_insert_random },
+    { "insert_asc", bench_insert_asc },
+    { "insert_desc", bench_insert_desc },
+    { "rotate", bench_rotate },
+    { "fix_colors", bench_fix_colors, true },
+    { "calibrate", bench_calibrate },
+    { "traverse", bench_traverse },
+    { "parent_get", bench_parent_get },
+    { "parent_raw", bench_parent_get_raw },
+    { "parent_set", bench_parent_set },
+    { "parent_set_raw", bench_parent_set_raw },
+};
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+static double median(double *v, size_t n)
+{
+    qsort(v, n, sizeof(*v), cmp_double);
+    return n & 1 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+/* Per window overhead: timer reads and counter ioctls around nothing */
+static void measure_window_cost(void)
+{
+    const size_t windows = 100000;
+
+    sample_begin();
+    for (size_t i = 0; i < windows; i++) {
+        window_open();
+        window_close();
+    }
+    sample_end();
+    window_cost.ns = cur.ns / windows;
+    for (int k = 0; k < NEVENTS; k++)
+        window_cost.ev[k] = cur.ev[k] < 0 ? 0 : cur.ev[k] / windows;
+}
+
+int main(int argc, char **argv)
+{
+    size_t times = 5, count = 100000;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:n:")) != -1) {
+        switch (opt) {
+        case 't':
+            times = strtoul(optarg, NULL, 0);
+            break;
+        case 'n':
+            count = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-t times] [-n count] [bench ...]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (!times || times > MAX_REPEATS || count < 2) {
+        fprintf(stderr, "need 1 <= times <= %d and count >= 2\n",
+                MAX_REPEATS);
+        return 1;
+    }
+
+    for (int k = 0; k < NEVENTS; k++)
+        counter[k] = perf_counter_new(PERF_TYPE_HARDWARE, events[k]);
+    nodes = malloc(sizeof(node_t) * count);
+    measure_window_cost();
+
+    printf("%-14s %-6s %9s %9s %8s %8s %8s %8s %8s\n", "bench", "tree", "n",
+           "ops", "ns/op", "cycles", "instr", "br_miss", "cache_miss");
+    for (size_t b = 0; b < ARRAY_SIZE(benches); b++) {
+        bool selected = optind == argc;
+        for (int a = optind; a < argc; a++)
+            selected |= !strcmp(argv[a], benches[b].name);
+        if (!selected)
+            continue;
+
+        double ns[MAX_REPEATS], ev[NEVENTS][MAX_REPEATS];
+        size_t ops = 0;
+        for (size_t t = 0; t < times; t++) {
+            sample_begin();
+            ops = benches[b].run(count);
+            sample_end();
+            if (!ops)
+                break;
+            double windows = benches[b].windowed ? ops : 1;
+            ns[t] = (cur.ns - windows * window_cost.ns) / ops;
+            for (int k = 0; k < NEVENTS; k++)
+                ev[k][t] = cur.ev[k] < 0
+                               ? -1
+                               : (cur.ev[k] - windows * window_cost.ev[k]) /
+                                     ops;
+        }
+
+        /* too small a tree for this benchmark to do anything */
+        if (!ops) {
+            printf("%-14s %-6s %9zu %9zu %8s", benches[b].name, BACKEND, count,
+                   ops, "-");
+            for (int k = 0; k < NEVENTS; k++)
+                printf(" %8s", "-");
+            printf("\n");
+            continue;
+        }
+
+        printf("%-14s %-6s %9zu %9zu %8.2f", benches[b].name, BACKEND, count,
+               ops, median(ns, times));
+        for (int k = 0; k < NEVENTS; k++) {
+            if (ev[k][0] < 0)
+                printf(" %8s", "-");
+            else
+                printf(" %8.2f", median(ev[k], times));
+        }
+        printf("\n");
+    }
+
+    for (int k = 0; k < NEVENTS; k++)
+        perf_counter_delete(counter[k]);
+    free(nodes);
+    return 0;
+}
@@ -0,0 +1,123 @@
+/*
+ * Intrusive list benchmark: the three dlist engines on a ring of structs
+ * that embed their struct list_head.
+ *
+ *   gcc -O2 -o bench_dlist bench_dlist.c dlist.c c_map_bit.c
+ *
+ * Prints one line per run: mergesort introsort treesort, in ns. -l and -i
+ * are the introsort depth limit and insertion sort cutoff (-l 0 goes
+ * straight to the tree fallback), -w draws keys over the whole long range
+ * instead of 0 .. count - 1.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "dlist.h"
+
+struct item {
+    long key;
+    struct list_head list;
+};
+
+DLIST_KEY_FUNC(item_key, struct item, list, key)
+
+static long now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000L + t.tv_nsec;
+}
+
+/* Fresh ring over @items in array order, the keys are left alone */
+static void make_ring(struct list_head *head, struct item *items, size_t n)
+{
+    INIT_LIST_HEAD(head);
+    for (size_t i = 0; i < n; i++)
+        list_add_tail(&items[i].list, head);
+}
+
+static void check(struct list_head *head, size_t n)
+{
+    struct list_head *pos;
+    size_t count = 0;
+
+    list_for_each(pos, head) {
+        assert(pos->next->prev == pos);
+        assert(pos->next == head || item_key(pos) <= item_key(pos->next));
+        count++;
+    }
+    assert(head->next->prev == head && count == n);
+}
+
+int main(int argc, char **argv)
+{
+    size_t times = 10, count = 100000;
+    int max_level = 32, insert = 21;
+    bool wide = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:n:l:i:w")) != -1) {
+        switch (opt) {
+        case 't':
+            times = strtoul(optarg, NULL, 0);
+            break;
+        case 'n':
+            count = strtoul(optarg, NULL, 0);
+            break;
+        case 'l':
+            max_level = atoi(optarg);
+            break;
+        case 'i':
+            insert = atoi(optarg);
+            break;
+        case 'w':
+            wide = true;
+            break;
+        default:
+            fprintf(stderr,
+                    "usage: %s [-t times] [-n count] [-l max_level] "
+                    "[-i insert] [-w]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    struct item *items = malloc(sizeof(struct item) * (count ? count : 1));
+    long *keys = malloc(sizeof(long) * (count ? count : 1));
+    assert(items && keys);
+
+    while (times--) {
+        LIST_HEAD(head);
+        long t0, t1;
+
+        for (size_t i = 0; i < count; i++)
+            keys[i] = wide ? (long) ((unsigned long) rand() << 33 ^
+                                     (unsigned long) rand() << 2 ^ rand())
+                           : rand() % (long) count;
+
+        for (int engine = 0; engine < 3; engine++) {
+            for (size_t i = 0; i < count; i++)
+                items[i].key = keys[i];
+            make_ring(&head, items, count);
+            t0 = now_ns();
+            if (engine == 0)
+                dlist_mergesort(&head, item_key);
+            else if (engine == 1)
+                dlist_introsort(&head, item_key, max_level, insert);
+            else
+                dlist_treesort(&head, item_key);
+            t1 = now_ns();
+            printf("%ld%c", t1 - t0, engine < 2 ? ' ' : '\n');
+            check(&head, count);
+        }
+    }
+
+    free(keys);
+    free(items);
+    return 0;
+}
@@ -0,0 +1,175 @@
+/*
+ * Sort index benchmark: red-black c_map against the B+tree and the index
+ * linked red-black tree.
+ *
+ * Times the two phases of a tree sort separately, the bulk insertion and
+ * the in-order relink of the list. The c_map backend is picked at build
+ * time:
+ *
+ *   gcc -O2 -o bench_index bench_index.c bptree.c c_map_idx.c c_map_bit.c
+ *   gcc -O2 -DC_MAP_PLAIN -o bench_index bench_index.c bptree.c c_map_idx.c \
+ *       c_map.c
+ *
+ * Prints one line per run: cmap_insert cmap_relink bptree_insert
+ * bptree_relink idx_insert idx_relink cmap_build cmap_range, in ns.
+ * cmap_build is c_map_build_from_sorted over the sorted list, the
+ * alternative to cmap_insert when the input is already in order.
+ * cmap_range is BENCH_RANGES range scans of BENCH_RANGE_KEYS keys each.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bptree.h"
+#include "c_map.h"
+#include "c_map_idx.h"
+#include "list.h"
+
+#define BENCH_RANGES 1000
+#define BENCH_RANGE_KEYS 64
+
+static long now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000L + t.tv_nsec;
+}
+
+static node_t *make_nodes(size_t n, bool sorted)
+{
+    node_t *nodes = malloc(sizeof(node_t) * n);
+
+    for (size_t i = 0; i < n; i++)
+        nodes[i].value = i;
+    for (size_t i = 0; !sorted && n > 1 && i < n - 1; i++) {
+        size_t j = i + rand() / (RAND_MAX / (n - i) + 1);
+        long t = nodes[j].value;
+        nodes[j].value = nodes[i].value;
+        nodes[i].value = t;
+    }
+    for (size_t i = 0; i < n; i++)
+        nodes[i].next = i + 1 < n ? &nodes[i + 1] : NULL;
+    return nodes;
+}
+
+static void check(node_t *list, size_t n)
+{
+    size_t count = 0;
+    for (; list; list = list->next, count++)
+        assert(!list->next || list->value <= list->next->value);
+    assert(count == n);
+}
+
+int main(int argc, char **argv)
+{
+    size_t times = 10, count = 100000;
+    bool sorted = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:n:s")) != -1) {
+        switch (opt) {
+        case 't':
+            times = strtoul(optarg, NULL, 0);
+            break;
+        case 'n':
+            count = strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            sorted = true;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-t times] [-n count] [-s]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    while (times--) {
+        node_t *nodes = make_nodes(count, sorted), *head, **link;
+        long t0, t1, t2;
+
+        /* red-black c_map */
+        c_map_t map = c_map_new(sizeof(long), sizeof(NULL), c_map_cmp_long);
+        t0 = now_ns();
+        for (node_t *node = count ? nodes : NULL; node; node = node->next)
+            c_map_insert(map, node, NULL);
+        t1 = now_ns();
+        link = &head;
+        for (node_t *node = c_map_first(map); node; node = c_map_next(node)) {
+            *link = node;
+            link = &(*link)->next;
+        }
+        *link = NULL;
+        t2 = now_ns();
+        printf("%ld %ld ", t1 - t0, t2 - t1);
+        check(head, count);
+        c_map_delete(map);
+
+        /* B+tree, fed in the original order again */
+        for (size_t i = 0; i < count; i++)
+            nodes[i].next = i + 1 < count ? &nodes[i + 1] : NULL;
+        bptree_t tree = bptree_new();
+        t0 = now_ns();
+        for (node_t *node = count ? nodes : NULL; node; node = node->next)
+            bptree_insert(tree, node);
+        t1 = now_ns();
+        head = bptree_relink(tree);
+        t2 = now_ns();
+        printf("%ld %ld ", t1 - t0, t2 - t1);
+        check(head, count);
+        bptree_delete(tree);
+
+        /* 32-bit index red-black tree */
+        for (size_t i = 0; i < count; i++)
+            nodes[i].next = i + 1 < count ? &nodes[i + 1] : NULL;
+        c_map_idx_t idx = c_map_idx_new(count);
+        bool full = !idx;
+        t0 = now_ns();
+        for (node_t *node = count ? nodes : NULL; node && !full;
+             node = node->next)
+            full = !c_map_idx_insert(idx, node);
+        t1 = now_ns();
+        if (full) {
+            fprintf(stderr, "index arena cannot grow\n");
+            return 1;
+        }
+        link = &head;
+        for (uint32_t i = c_map_idx_first(idx); i; i = c_map_idx_next(idx, i)) {
+            *link = c_map_idx_node(idx, i);
+            link = &(*link)->next;
+        }
+        *link = NULL;
+        t2 = now_ns();
+        printf("%ld %ld ", t1 - t0, t2 - t1);
+        check(head, count);
+        c_map_idx_delete(idx);
+
+        /* red-black c_map again, bulk built from the sorted list */
+        map = c_map_new(sizeof(long), sizeof(NULL), c_map_cmp_long);
+        t0 = now_ns();
+        c_map_build_from_sorted(map, head, count);
+        t1 = now_ns();
+        assert(c_map_first(map) == head);
+
+        /* keys are 0 .. count - 1, each range holds BENCH_RANGE_KEYS */
+        size_t seen = 0, ranges = count > BENCH_RANGE_KEYS ? BENCH_RANGES : 0;
+        for (size_t r = 0; r < ranges; r++) {
+            long lo = rand() % (count - BENCH_RANGE_KEYS);
+            long hi = lo + BENCH_RANGE_KEYS;
+            c_map_range_t range = c_map_range(map, &lo, &hi);
+            while (c_map_range_next(&range))
+                seen++;
+        }
+        t2 = now_ns();
+        printf("%ld %ld\n", t1 - t0, t2 - t1);
+        assert(seen == ranges * BENCH_RANGE_KEYS);
+        c_map_delete(map);
+
+        free(nodes);
+    }
+    return 0;
+}
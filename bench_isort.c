@@ -0,0 +1,180 @@
+/*
+ * Generic intrusive sort benchmark: the isort.h engines instantiated on a
+ * record struct, against copying the keys out into node_t, sorting those
+ * and relinking the records.
+ *
+ *   gcc -O2 -o bench_isort bench_isort.c sorter.c list.c
+ *
+ * Records carry an id drawn from 0 .. count / 4 - 1 (so keys repeat) and
+ * their input position. rec_by_id is generated by ISORT_DEFINE_KEY on the
+ * id, rec_by_bucket by ISORT_DEFINE_ACCESSOR on id / 16. Prints one line
+ * per run: id_merge id_intro bucket_merge bucket_intro copy, in ns. copy
+ * is the node_t detour through the streaming sorter (sorter.c). Every
+ * result is checked for order, the merge sorts and copy also for
+ * stability.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "isort.h"
+#include "list.h"
+#include "sorter.h"
+
+struct rec {
+    char name[16];
+    long id;
+    size_t seq;         /* input position, for the stability check */
+    struct slist_link link;
+};
+
+static inline long rec_bucket(const struct rec *r)
+{
+    return r->id / 16;
+}
+
+ISORT_DEFINE_KEY(rec_by_id, struct rec, link, id)
+ISORT_DEFINE_ACCESSOR(rec_by_bucket, struct rec, link, long, rec_bucket)
+
+static long now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000L + t.tv_nsec;
+}
+
+/* Link the records in array order */
+static struct slist_link *make_list(struct rec *recs, size_t n)
+{
+    struct slist_link *head = NULL, **tail = &head;
+
+    for (size_t i = 0; i < n; i++) {
+        *tail = &recs[i].link;
+        tail = &recs[i].link.next;
+    }
+    *tail = NULL;
+    return head;
+}
+
+static void check(struct slist_link *list, size_t n, bool bucket, bool stable)
+{
+    size_t count = 0;
+
+    for (; list; list = list->next, count++) {
+        if (!list->next)
+            continue;
+        struct rec *a = slist_entry(list, struct rec, link);
+        struct rec *b = slist_entry(list->next, struct rec, link);
+        long ka = bucket ? rec_bucket(a) : a->id;
+        long kb = bucket ? rec_bucket(b) : b->id;
+        assert(ka <= kb);
+        assert(!stable || ka < kb || a->seq < b->seq);
+    }
+    assert(count == n);
+}
+
+/* Copy the ids into node_t, sort those, relink the records in that order */
+static void copy_sort(struct slist_link **list, size_t n)
+{
+    node_t *nodes = malloc(sizeof(node_t) * (n ? n : 1));
+    sorter_t sorter = sorter_new();
+    size_t i = 0;
+
+    for (struct slist_link *p = *list; p; p = p->next, i++) {
+        nodes[i].value = slist_entry(p, struct rec, link)->id;
+        nodes[i].left = (node_t *) p;   /* back to the record */
+        sorter_push(sorter, &nodes[i]);
+    }
+    struct slist_link **tail = list;
+    for (node_t *node = sorter_finish(sorter); node; node = node->next) {
+        *tail = (struct slist_link *) node->left;
+        tail = &(*tail)->next;
+    }
+    *tail = NULL;
+    sorter_delete(sorter);
+    free(nodes);
+}
+
+int main(int argc, char **argv)
+{
+    size_t times = 10, count = 100000;
+    int max_level = 32, insert = 21;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:n:l:i:")) != -1) {
+        switch (opt) {
+        case 't':
+            times = strtoul(optarg, NULL, 0);
+            break;
+        case 'n':
+            count = strtoul(optarg, NULL, 0);
+            break;
+        case 'l':
+            max_level = atoi(optarg);
+            break;
+        case 'i':
+            insert = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr,
+                    "usage: %s [-t times] [-n count] [-l max_level] "
+                    "[-i insert]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    struct rec *recs = malloc(sizeof(struct rec) * (count ? count : 1));
+    long range = count >= 4 ? (long) count / 4 : 1;
+    assert(recs);
+
+    /* insertion sort is quadratic, only checked on a short prefix */
+    for (size_t i = 0; i < count; i++)
+        recs[i] = (struct rec){ .id = rand() % range, .seq = i };
+    struct slist_link *list = make_list(recs, count < 1000 ? count : 1000);
+    rec_by_id_insertsort(&list);
+    check(list, count < 1000 ? count : 1000, false, true);
+    list = make_list(recs, count < 1000 ? count : 1000);
+    rec_by_bucket_insertsort(&list);
+    check(list, count < 1000 ? count : 1000, true, true);
+
+    while (times--) {
+        for (size_t i = 0; i < count; i++)
+            recs[i] = (struct rec){ .id = rand() % range, .seq = i };
+
+        for (int engine = 0; engine < 5; engine++) {
+            bool bucket = engine == 2 || engine == 3;
+            bool stable = engine != 1 && engine != 3;
+            long t0, t1;
+
+            list = make_list(recs, count);
+            t0 = now_ns();
+            switch (engine) {
+            case 0:
+                rec_by_id_mergesort(&list);
+                break;
+            case 1:
+                rec_by_id_introsort(&list, max_level, insert);
+                break;
+            case 2:
+                rec_by_bucket_mergesort(&list);
+                break;
+            case 3:
+                rec_by_bucket_introsort(&list, max_level, insert);
+                break;
+            default:
+                copy_sort(&list, count);
+            }
+            t1 = now_ns();
+            printf("%ld%c", t1 - t0, engine < 4 ? ' ' : '\n');
+            check(list, count, bucket, stable);
+        }
+    }
+
+    free(recs);
+    return 0;
+}
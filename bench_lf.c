@@ -0,0 +1,130 @@
+/*
+ * Concurrent sorted ingest benchmark: lock-free list against insert_sorted
+ * behind one mutex.
+ *
+ *   gcc -O2 -pthread -o bench_lf bench_lf.c lf_list.c list.c
+ *
+ * For 1..max producers, every producer inserts its share of "count"
+ * random keys into one shared list. Prints one line per producer count:
+ * producers lockfree_inserts_per_sec mutex_inserts_per_sec.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lf_list.h"
+#include "list.h"
+
+struct producer {
+    pthread_t thread;
+    node_t *nodes;
+    size_t count;
+};
+
+static lf_list_t lf;
+static node_t *locked;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_barrier_t start;
+
+static long now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000L + t.tv_nsec;
+}
+
+static void *lf_producer(void *arg)
+{
+    struct producer *p = arg;
+
+    pthread_barrier_wait(&start);
+    for (size_t i = 0; i < p->count; i++)
+        lf_list_insert(&lf, &p->nodes[i]);
+    return NULL;
+}
+
+static void *mutex_producer(void *arg)
+{
+    struct producer *p = arg;
+
+    pthread_barrier_wait(&start);
+    for (size_t i = 0; i < p->count; i++) {
+        pthread_mutex_lock(&lock);
+        insert_sorted(&p->nodes[i], &locked);
+        pthread_mutex_unlock(&lock);
+    }
+    return NULL;
+}
+
+/* Returns inserts per second */
+static double run(int producers, size_t count, node_t *nodes, bool lockfree)
+{
+    struct producer p[producers];
+    long t0, t1;
+
+    lf_list_init(&lf);
+    locked = NULL;
+    pthread_barrier_init(&start, NULL, producers + 1);
+    for (int i = 0; i < producers; i++) {
+        size_t beg = count * i / producers, end = count * (i + 1) / producers;
+        p[i].nodes = nodes + beg;
+        p[i].count = end - beg;
+        pthread_create(&p[i].thread, NULL,
+                       lockfree ? lf_producer : mutex_producer, &p[i]);
+    }
+    t0 = now_ns();
+    pthread_barrier_wait(&start);
+    for (int i = 0; i < producers; i++)
+        pthread_join(p[i].thread, NULL);
+    t1 = now_ns();
+    pthread_barrier_destroy(&start);
+
+    /* Everything in, in order */
+    node_t *node = lockfree ? lf_list_first(&lf) : locked;
+    size_t n = 0;
+    for (; node; node = lockfree ? lf_list_next(node) : node->next, n++) {
+        node_t *next = lockfree ? lf_list_next(node) : node->next;
+        assert(!next || node->value <= next->value);
+    }
+    assert(n == count);
+
+    return count / ((t1 - t0) / 1e9);
+}
+
+int main(int argc, char **argv)
+{
+    size_t count = 20000;
+    int max = 8, opt;
+
+    while ((opt = getopt(argc, argv, "n:p:")) != -1) {
+        switch (opt) {
+        case 'n':
+            count = strtoul(optarg, NULL, 0);
+            break;
+        case 'p':
+            max = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-n count] [-p max_producers]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    node_t *nodes = malloc(sizeof(node_t) * count);
+    for (size_t i = 0; i < count; i++)
+        nodes[i].value = rand();
+
+    for (int producers = 1; producers <= max; producers++) {
+        double lockfree = run(producers, count, nodes, true);
+        double mutex = run(producers, count, nodes, false);
+        printf("%d %.0f %.0f\n", producers, lockfree, mutex);
+    }
+
+    free(nodes);
+    return 0;
+}
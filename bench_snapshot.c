@@ -0,0 +1,207 @@
+/*
+ * Snapshot reload benchmark: rebuilding a sorted list at startup from the
+ * raw values plus a sort against loading a delta encoded snapshot
+ * (snapshot.c), read into a buffer or mmap'ed.
+ *
+ *   gcc -O2 -o bench_snapshot bench_snapshot.c snapshot.c node_pool.c \
+ *       sorter.c list.c
+ *
+ * Keys are -n random values with an average gap of -g. The first line
+ * gives the raw and the snapshot file sizes in bytes, then one line per
+ * run: raw_sort snap_read snap_mmap snap_range, in ns. snap_range is
+ * BENCH_RANGES range loads of about BENCH_RANGE_KEYS keys each. The files
+ * are written under -d and stay in the page cache, so this is the decode
+ * cost, not the disk. Every reload takes its nodes from a fresh node pool
+ * so none of them inherits a heap the previous one scattered.
+ */
+
+#include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "list.h"
+#include "node_pool.h"
+#include "snapshot.h"
+#include "sorter.h"
+
+#define BENCH_RANGES 1000
+#define BENCH_RANGE_KEYS 64
+
+static long now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000L + t.tv_nsec;
+}
+
+static long file_size(const char *path)
+{
+    struct stat st;
+    return stat(path, &st) ? -1 : st.st_size;
+}
+
+/* Out of order, or not @n nodes when @full: stop, the numbers are void */
+static void check(node_t *list, size_t n, bool full)
+{
+    size_t count = 0;
+    for (; list; list = list->next, count++)
+        if (list->next && list->value > list->next->value)
+            break;
+    if (list || (full && count != n)) {
+        fprintf(stderr, "reloaded list is wrong\n");
+        exit(1);
+    }
+}
+
+/* What a service does today: read the raw values back and sort again */
+static node_t *raw_reload(const char *path, node_pool_t pool)
+{
+    FILE *f = fopen(path, "rb");
+    node_t *list = NULL, **tail = &list;
+    long value;
+
+    assert(f);
+    while (fread(&value, sizeof(value), 1, f) == 1) {
+        node_t *node = node_pool_alloc(pool);
+        node->value = value;
+        *tail = node;
+        tail = &node->next;
+    }
+    *tail = NULL;
+    fclose(f);
+
+    sorter_t sorter = sorter_new();
+    sorter_push_batch(sorter, list);
+    list = sorter_finish(sorter);
+    sorter_delete(sorter);
+    return list;
+}
+
+static long snap_reload(const char *path, snapshot_io_t io, size_t n)
+{
+    long t0 = now_ns();
+    node_pool_t pool = node_pool_new(n, NODE_POOL_4K);
+    snapshot_t snap = snapshot_open(path, io);
+    node_t *list = NULL;
+
+    if (!snap || snapshot_load(snap, pool, &list)) {
+        fprintf(stderr, "%s: cannot load snapshot\n", path);
+        exit(1);
+    }
+    snapshot_close(snap);
+    long t1 = now_ns();
+    check(list, n, true);
+    node_pool_delete(pool);
+    return t1 - t0;
+}
+
+int main(int argc, char **argv)
+{
+    size_t times = 10, count = 1000000, gap = 16;
+    const char *dir = "/tmp";
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:n:g:d:")) != -1) {
+        switch (opt) {
+        case 't':
+            times = strtoul(optarg, NULL, 0);
+            break;
+        case 'n':
+            count = strtoul(optarg, NULL, 0);
+            break;
+        case 'g':
+            gap = strtoul(optarg, NULL, 0);
+            break;
+        case 'd':
+            dir = optarg;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-t times] [-n count] [-g gap] [-d dir]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    char raw_path[PATH_MAX], snap_path[PATH_MAX];
+    snprintf(raw_path, sizeof(raw_path), "%s/bench_snapshot.raw", dir);
+    snprintf(snap_path, sizeof(snap_path), "%s/bench_snapshot.snap", dir);
+
+    /* raw file in arrival order, snapshot of the sorted list */
+    long *values = malloc(sizeof(long) * (count ? count : 1));
+    long range = (long) (count * gap) > 0 ? (long) (count * gap) : 1;
+    node_t *list = NULL;
+    for (size_t i = 0; i < count; i++) {
+        values[i] = ((long) rand() << 31 | rand()) % range;
+        list = list_make_node_t(list, 0);
+        list->value = values[i];
+    }
+    FILE *f = fopen(raw_path, "wb");
+    if (!f || fwrite(values, sizeof(long), count, f) != count || fclose(f)) {
+        perror(raw_path);
+        return 1;
+    }
+
+    sorter_t sorter = sorter_new();
+    sorter_push_batch(sorter, list);
+    list = sorter_finish(sorter);
+    sorter_delete(sorter);
+    if (snapshot_save(snap_path, list)) {
+        perror(snap_path);
+        return 1;
+    }
+    if (list)
+        list_free(&list);
+    printf("%ld %ld\n", file_size(raw_path), file_size(snap_path));
+
+    long lo[BENCH_RANGES], span = (long) (BENCH_RANGE_KEYS * gap);
+    node_t *ranges[BENCH_RANGES];
+
+    while (times--) {
+        long t0 = now_ns();
+        node_pool_t pool = node_pool_new(count, NODE_POOL_4K);
+        list = raw_reload(raw_path, pool);
+        long t1 = now_ns();
+        printf("%ld ", t1 - t0);
+        check(list, count, true);
+        node_pool_delete(pool);
+
+        printf("%ld ", snap_reload(snap_path, SNAPSHOT_READ, count));
+        printf("%ld ", snap_reload(snap_path, SNAPSHOT_MMAP, count));
+
+        /* only the range loads are timed, checks and frees come after */
+        snapshot_t snap = snapshot_open(snap_path, SNAPSHOT_MMAP);
+        if (!snap) {
+            fprintf(stderr, "%s: cannot open snapshot\n", snap_path);
+            return 1;
+        }
+        for (size_t r = 0; r < BENCH_RANGES; r++)
+            lo[r] = ((long) rand() << 31 | rand()) % range;
+        int failed = 0;
+        t0 = now_ns();
+        for (size_t r = 0; r < BENCH_RANGES; r++)
+            failed |= snapshot_load_range(snap, lo[r], lo[r] + span, NULL,
+                                          &ranges[r]);
+        t1 = now_ns();
+        printf("%ld\n", t1 - t0);
+        snapshot_close(snap);
+
+        assert(!failed);
+        for (size_t r = 0; r < BENCH_RANGES; r++) {
+            check(ranges[r], 0, false);
+            for (node_t *node = ranges[r]; node; node = node->next)
+                assert(node->value >= lo[r] && node->value <= lo[r] + span);
+            if (ranges[r])
+                list_free(&ranges[r]);
+        }
+    }
+
+    unlink(raw_path);
+    unlink(snap_path);
+    free(values);
+    return 0;
+}
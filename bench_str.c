@@ -0,0 +1,135 @@
+/*
+ * String sort benchmark: multikey quick sort on str_node_t against tree
+ * sort through c_map with a strcmp comparator (node_t value holds the
+ * "char *").
+ *
+ *   gcc -O2 -o bench_str bench_str.c strsort.c c_map_bit.c
+ *
+ * Prints one line per run: mkqsort treesort, in ns. -d picks the key
+ * shape, -s hands both sorts their keys already in order.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "c_map.h"
+#include "strsort.h"
+
+static const char *hosts[] = {
+    "https://www.example.com/", "https://api.example.com/v1/",
+    "https://cdn.example.net/assets/", "http://intranet.local/wiki/",
+};
+
+static const char alnum[] = "abcdefghijklmnopqrstuvwxyz0123456789_";
+
+static long now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000L + t.tv_nsec;
+}
+
+static int cmp_key(const void *a, const void *b)
+{
+    return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+/* n NUL terminated keys packed in one buffer, returned through keys[] */
+static char *make_keys(char **keys, size_t n, bool url)
+{
+    char *buf = malloc(n * 96), *p = buf;
+
+    for (size_t i = 0; i < n; i++) {
+        keys[i] = p;
+        if (url)
+            p += sprintf(p, "%s", hosts[rand() % 4]);
+        int len = 4 + rand() % 20;
+        for (int k = 0; k < len; k++)
+            *p++ = alnum[rand() % (sizeof(alnum) - 1)];
+        if (url && rand() % 2)
+            p += sprintf(p, "/item/%d", rand() % 1000);
+        *p++ = '\0';
+    }
+    return buf;
+}
+
+int main(int argc, char **argv)
+{
+    size_t times = 10, count = 100000;
+    bool url = true, sorted = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:n:d:s")) != -1) {
+        switch (opt) {
+        case 't':
+            times = strtoul(optarg, NULL, 0);
+            break;
+        case 'n':
+            count = strtoul(optarg, NULL, 0);
+            break;
+        case 'd':
+            url = strcmp(optarg, "ident") != 0;
+            break;
+        case 's':
+            sorted = true;
+            break;
+        default:
+            fprintf(stderr,
+                    "usage: %s [-t times] [-n count] [-d url|ident] [-s]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    char **keys = malloc(sizeof(char *) * count);
+
+    while (times--) {
+        char *buf = make_keys(keys, count, url);
+        long t0, t1;
+
+        if (sorted)
+            qsort(keys, count, sizeof(*keys), cmp_key);
+
+        /* multikey quick sort */
+        str_node_t *slist = NULL;
+        for (size_t i = count; i--; )
+            slist = str_list_make_node(slist, keys[i], strlen(keys[i]));
+        t0 = now_ns();
+        str_mkqsort(&slist);
+        t1 = now_ns();
+        printf("%ld ", t1 - t0);
+        size_t n = 0;
+        for (str_node_t *s = slist; s; s = s->next, n++)
+            assert(!s->next || strcmp(s->key, s->next->key) <= 0);
+        assert(n == count);
+        str_list_free(&slist);
+
+        /* c_map tree sort with strcmp */
+        node_t *nodes = malloc(sizeof(node_t) * count), *head, **link = &head;
+        for (size_t i = 0; i < count; i++)
+            nodes[i].value = (long) keys[i];
+        c_map_t map = c_map_new(sizeof(char *), sizeof(NULL), c_map_cmp_str);
+        t0 = now_ns();
+        for (size_t i = 0; i < count; i++)
+            c_map_insert(map, &nodes[i], NULL);
+        for (node_t *node = c_map_first(map); node; node = c_map_next(node)) {
+            *link = node;
+            link = &(*link)->next;
+        }
+        *link = NULL;
+        t1 = now_ns();
+        printf("%ld\n", t1 - t0);
+        for (node_t *s = head; s && s->next; s = s->next)
+            assert(strcmp((char *) s->value, (char *) s->next->value) <= 0);
+        c_map_delete(map);
+        free(nodes);
+
+        free(buf);
+    }
+    free(keys);
+    return 0;
+}
@@ -0,0 +1,222 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bptree.h"
+#include "memprof.h"
+#include "stats.h"
+
+#define BPTREE_CHUNK (64 * 1024)
+#define CACHE_LINE 64
+
+struct bptree_leaf {
+    long key[BPTREE_KEYS];
+    node_t *item[BPTREE_KEYS];
+    struct bptree_leaf *next;
+    int count;
+};
+
+struct bptree_inner {
+    long key[BPTREE_KEYS];
+    void *child[BPTREE_KEYS + 1];
+    int count;  /* number of keys, count + 1 children */
+};
+
+/* Tree nodes are carved out of large chunks and released all at once */
+struct bptree_chunk {
+    struct bptree_chunk *next;
+};
+
+struct bptree_internal {
+    void *root;
+    int height;     /* 0 when the root is a leaf */
+    size_t size;
+
+    struct bptree_leaf *first;
+
+    struct bptree_chunk *chunks;
+    char *cur, *end;
+};
+
+static void *bptree_alloc(bptree_t obj, size_t size)
+{
+    size = (size + CACHE_LINE - 1) & ~(size_t) (CACHE_LINE - 1);
+    if (obj->cur + size > obj->end) {
+        struct bptree_chunk *chunk =
+            mem_aligned_alloc(CACHE_LINE, BPTREE_CHUNK);
+        assert(chunk);
+        chunk->next = obj->chunks;
+        obj->chunks = chunk;
+        obj->cur = (char *) chunk + CACHE_LINE;
+        obj->end = (char *) chunk + BPTREE_CHUNK;
+    }
+    void *p = obj->cur;
+    obj->cur += size;
+    return p;
+}
+
+static struct bptree_leaf *bptree_new_leaf(bptree_t obj)
+{
+    struct bptree_leaf *leaf = bptree_alloc(obj, sizeof(*leaf));
+    leaf->next = NULL;
+    leaf->count = 0;
+    return leaf;
+}
+
+static struct bptree_inner *bptree_new_inner(bptree_t obj)
+{
+    struct bptree_inner *inner = bptree_alloc(obj, sizeof(*inner));
+    inner->count = 0;
+    return inner;
+}
+
+/* Index of the first key greater than "key", equal keys are passed over */
+static inline int bptree_upper_bound(const long *keys, int count, long key)
+{
+    int i = 0;
+    while (i < count && (STATS_INC(cmp), keys[i] <= key))
+        i++;
+    return i;
+}
+
+/*
+ * Split the full child at parent->child[i] in two halves, the upper half
+ * moves to a new right sibling inserted at i + 1.
+ */
+static void bptree_split_child(bptree_t obj,
+                               struct bptree_inner *parent,
+                               int i,
+                               bool leaf)
+{
+    long sep;
+    void *right;
+
+    if (leaf) {
+        struct bptree_leaf *l = parent->child[i], *r = bptree_new_leaf(obj);
+        int half = BPTREE_KEYS / 2;
+
+        r->count = BPTREE_KEYS - half;
+        memcpy(r->key, l->key + half, sizeof(long) * r->count);
+        memcpy(r->item, l->item + half, sizeof(node_t *) * r->count);
+        l->count = half;
+        r->next = l->next;
+        l->next = r;
+        sep = r->key[0];
+        right = r;
+    } else {
+        struct bptree_inner *l = parent->child[i], *r = bptree_new_inner(obj);
+        int mid = BPTREE_KEYS / 2;
+
+        /* key[mid] moves up, the right node gets what is above it */
+        sep = l->key[mid];
+        r->count = BPTREE_KEYS - mid - 1;
+        memcpy(r->key, l->key + mid + 1, sizeof(long) * r->count);
+        memcpy(r->child, l->child + mid + 1, sizeof(void *) * (r->count + 1));
+        l->count = mid;
+        right = r;
+    }
+
+    memmove(parent->key + i + 1, parent->key + i,
+            sizeof(long) * (parent->count - i));
+    memmove(parent->child + i + 2, parent->child + i + 1,
+            sizeof(void *) * (parent->count - i));
+    parent->key[i] = sep;
+    parent->child[i + 1] = right;
+    parent->count++;
+}
+
+static inline bool bptree_full(void *node, bool leaf)
+{
+    if (leaf)
+        return ((struct bptree_leaf *) node)->count == BPTREE_KEYS;
+    return ((struct bptree_inner *) node)->count == BPTREE_KEYS;
+}
+
+bptree_t bptree_new(void)
+{
+    bptree_t obj = mem_malloc(sizeof(struct bptree_internal));
+
+    obj->chunks = NULL;
+    obj->cur = obj->end = NULL;
+    obj->first = bptree_new_leaf(obj);
+    obj->root = obj->first;
+    obj->height = 0;
+    obj->size = 0;
+
+    return obj;
+}
+
+/*
+ * Insert with top-down splitting: any full node met on the way down is
+ * split before descending into it, so the leaf always has room and no
+ * split has to travel back up.
+ */
+void bptree_insert(bptree_t obj, node_t *node)
+{
+    long key = node->value;
+
+    if (bptree_full(obj->root, obj->height == 0)) {
+        struct bptree_inner *root = bptree_new_inner(obj);
+        root->child[0] = obj->root;
+        bptree_split_child(obj, root, 0, obj->height == 0);
+        obj->root = root;
+        obj->height++;
+    }
+
+    void *cur = obj->root;
+    for (int level = obj->height; level > 0; level--) {
+        struct bptree_inner *inner = cur;
+        int i = bptree_upper_bound(inner->key, inner->count, key);
+
+        if (bptree_full(inner->child[i], level == 1)) {
+            bptree_split_child(obj, inner, i, level == 1);
+            if (key >= inner->key[i])
+                i++;
+        }
+        cur = inner->child[i];
+    }
+
+    struct bptree_leaf *leaf = cur;
+    int i = bptree_upper_bound(leaf->key, leaf->count, key);
+
+    memmove(leaf->key + i + 1, leaf->key + i,
+            sizeof(long) * (leaf->count - i));
+    memmove(leaf->item + i + 1, leaf->item + i,
+            sizeof(node_t *) * (leaf->count - i));
+    leaf->key[i] = key;
+    leaf->item[i] = node;
+    leaf->count++;
+    obj->size++;
+}
+
+node_t *bptree_relink(bptree_t obj)
+{
+    node_t *head = NULL, **link = &head;
+
+    for (struct bptree_leaf *leaf = obj->first; leaf; leaf = leaf->next) {
+        for (int i = 0; i < leaf->count; i++) {
+            *link = leaf->item[i];
+            link = &(*link)->next;
+            STATS_INC(next_writes);
+        }
+    }
+    *link = NULL;
+    return head;
+}
+
+size_t bptree_size(bptree_t obj)
+{
+    return obj->size;
+}
+
+void bptree_delete(bptree_t obj)
+{
+    struct bptree_chunk *chunk = obj->chunks;
+
+    while (chunk) {
+        struct bptree_chunk *next = chunk->next;
+        mem_free(chunk);
+        chunk = next;
+    }
+    mem_free(obj);
+}
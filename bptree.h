@@ -0,0 +1,40 @@
+/*
+ * B+tree sort index over node_t.
+ *
+ * An alternative to the red-black c_map for tree sort: inner nodes hold
+ * BPTREE_KEYS keys (two cache lines) so a descent touches about log16(n)
+ * nodes instead of log2(n), and the leaves keep a copy of the key next to
+ * the node_t pointer so neither the search nor the in-order walk has to
+ * dereference the list nodes. Leaves are chained, the sorted list is
+ * relinked by walking that chain once.
+ *
+ * Equal keys are inserted after the existing ones, so the order is stable.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "type.h"
+
+#define BPTREE_KEYS 16
+
+typedef struct bptree_internal *bptree_t;
+
+/* Constructor */
+bptree_t bptree_new(void);
+
+/* Add node, keyed by node->value */
+void bptree_insert(bptree_t obj, node_t *node);
+
+/*
+ * Link every inserted node in key order through "next", returns the head.
+ * The tree itself is left untouched.
+ */
+node_t *bptree_relink(bptree_t obj);
+
+size_t bptree_size(bptree_t obj);
+
+/* Destructor, frees the index only, not the list nodes */
+void bptree_delete(bptree_t obj);
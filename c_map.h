@@ -16,6 +16,7 @@ extern "C" {
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <string.h>
 
 #include "type.h"
 
@@ -42,6 +43,19 @@ static inline int c_map_cmp_uint(void *arg0, void *arg1)
     return (*a < *b) ? _CMP_LESS : (*a > *b) ? _CMP_GREATER : _CMP_EQUAL;
 }
 
+/* Long comparison, the key type of node_t */
+static inline int c_map_cmp_long(void *arg0, void *arg1)
+{
+    long *a = (long *) arg0, *b = (long *) arg1;
+    return (*a < *b) ? _CMP_LESS : (*a > *b) ? _CMP_GREATER : _CMP_EQUAL;
+}
+
+/* String comparison, the key holds a "char *" */
+static inline int c_map_cmp_str(void *arg0, void *arg1)
+{
+    return strcmp(*(char **) arg0, *(char **) arg1);
+}
+
 
 
 #define container_of(ptr, type, member) ({ \
@@ -61,11 +75,37 @@ c_map_t c_map_new(size_t, size_t, int (*)(void *, void *));
 /* Add function */
 bool c_map_insert(c_map_t obj, node_t *node, void *value);
 
+/* Balanced tree from the first n nodes of a sorted list, map must be empty */
+void c_map_build_from_sorted(c_map_t obj, node_t *list, size_t n);
+
 /* Destructor */
 void c_map_delete(c_map_t);
 
 node_t *c_map_first(c_map_t obj);
 node_t *c_map_next(node_t *node);
+node_t *c_map_last(c_map_t obj);
+node_t *c_map_prev(node_t *node);
+
+/* First node not less than / greater than "key", NULL if there is none */
+node_t *c_map_lower_bound(c_map_t obj, void *key);
+node_t *c_map_upper_bound(c_map_t obj, void *key);
+
+/* First node (in order) equal to "key", NULL if absent */
+node_t *c_map_find(c_map_t obj, void *key);
+
+/*
+ * Range scan over [lo, hi): two descents, then one c_map_next per node.
+ *
+ *   c_map_range_t r = c_map_range(map, &lo, &hi);
+ *   for (node_t *node; (node = c_map_range_next(&r)); )
+ *       ...
+ */
+typedef struct {
+    node_t *node, *end;
+} c_map_range_t;
+
+c_map_range_t c_map_range(c_map_t obj, void *lo, void *hi);
+node_t *c_map_range_next(c_map_range_t *range);
 
 static node_t *c_map_create_node(node_t *node);
 
@@ -5,6 +5,8 @@
 #include <stdio.h>
 
 #include "c_map.h"
+#include "memprof.h"
+#include "stats.h"
 
 static node_t *c_map_create_node(node_t *node)
 {
@@ -33,6 +35,7 @@ static node_t *c_map_create_node(node_t *node)
  */
 static node_t *c_map_rotate_left(c_map_t obj, node_t *node)
 {
+    STATS_INC(rotations);
     node_t *r = node->right, *rl = r->left, *up = rb_parent(node);
 
     /* Adjust */
@@ -72,6 +75,7 @@ static node_t *c_map_rotate_left(c_map_t obj, node_t *node)
  */
 static node_t *c_map_rotate_right(c_map_t obj, node_t *node)
 {
+    STATS_INC(rotations);
     node_t *l = node->left, *lr = l->right, *up = rb_parent(node);
 
     // Adjust
@@ -186,6 +190,7 @@ static void c_map_fix_colors(c_map_t obj, node_t *node)
     /* If root, set the color to black */
     if (node == obj->head) {
         rb_set_black(node);
+        STATS_INC(recolors);
         return;
     }
 
@@ -212,11 +217,13 @@ static void c_map_fix_colors(c_map_t obj, node_t *node)
 
         /* Change color of grandparent to red. */
         rb_set_red(grandparent);
+        STATS_ADD(recolors, 3);
 
         /* Call this on the grandparent */
         c_map_fix_colors(obj, grandparent);
     } else if (!uncle || rb_is_black(uncle)) {
-        /* If the uncle is black. */
+        /* If the uncle is black, rotate and swap two colors. */
+        STATS_ADD(recolors, 2);
         if (parent == grandparent->left && node == parent->left)
             c_map_l_l(obj, node, parent, grandparent, uncle);
         else if (parent == grandparent->left && node == parent->right)
@@ -366,7 +373,7 @@ static void c_map_calibrate(c_map_t obj)
  */
 c_map_t c_map_new(size_t s1, size_t s2, int (*cmp)(void *, void *))
 {
-    c_map_t obj = malloc(sizeof(struct c_map_internal));
+    c_map_t obj = mem_malloc(sizeof(struct c_map_internal));
 
     // Set all pointers to NULL
     obj->head = NULL;
@@ -417,10 +424,12 @@ bool c_map_insert(c_map_t obj, node_t *node, void *value)
     node_t *cur = obj->head;
 
     while (1) {
+        /*
+         * Equal keys go to the right, so duplicates are kept in insertion
+         * order and the in-order walk stays stable.
+         */
         int res = obj->comparator(&node->value, &cur->value);
-        if (res == 0) { /* If the key matches something else, don't insert */
-            assert(0 && "not support repetitive value");
-        }
+        STATS_INC(cmp);
 
         if (res < 0) {
             if (!cur->left) {
@@ -445,6 +454,59 @@ bool c_map_insert(c_map_t obj, node_t *node, void *value)
     return true;
 }
 
+/*
+ * Build the subtree of the next "n" nodes of *cur, in list order: the left
+ * half, the middle node, the right half. Sizes of sibling subtrees differ by
+ * at most one, so every level but the deepest ("red") is full; coloring
+ * that level red keeps all black heights equal.
+ */
+static node_t *c_map_build(node_t **cur, size_t n, size_t depth, size_t red)
+{
+    if (!n)
+        return NULL;
+
+    node_t *left = c_map_build(cur, (n - 1) / 2, depth + 1, red);
+    node_t *node = *cur;
+    *cur = node->next;
+    node_t *right = c_map_build(cur, n - 1 - (n - 1) / 2, depth + 1, red);
+
+    node->left = left;
+    node->right = right;
+    node->color = 0;
+    if (left)
+        rb_set_parent(left, node);
+    if (right)
+        rb_set_parent(right, node);
+    if (red && depth == red)
+        rb_set_red(node);
+    else
+        rb_set_black(node);
+    return node;
+}
+
+/*
+ * Build a balanced tree out of the first "n" nodes of a list sorted by the
+ * map's comparator, in one pass without comparisons or rotations. The map
+ * must be empty. The "next" links of the nodes are left alone.
+ */
+void c_map_build_from_sorted(c_map_t obj, node_t *list, size_t n)
+{
+    size_t red = 0;
+
+    assert(!obj->head);
+    while ((n + 1) >> (red + 1))
+        red++;
+    /* depth of the deepest level; if it is full, all nodes stay black */
+    if (((size_t) 1 << red) - 1 == n)
+        red = 0;
+
+    obj->head = c_map_build(&list, n, 0, red);
+    obj->size = n;
+    if (obj->head)
+        rb_set_parent(obj->head, NULL);
+    c_map_calibrate(obj);
+}
+
 node_t *c_map_first(c_map_t obj)
 {
 	node_t *n;
@@ -488,9 +550,98 @@ node_t *c_map_next(node_t *node)
 	return parent;
 }
 
+node_t *c_map_last(c_map_t obj)
+{
+    /* it_most is recalibrated by every insertion and bulk build */
+    return obj->it_most.node;
+}
+
+node_t *c_map_prev(node_t *node)
+{
+    node_t *parent;
+
+    if (!node)
+        return NULL;
+
+    /* Mirror image of c_map_next */
+    if (node->left) {
+        node = node->left;
+        while (node->right)
+            node = node->right;
+        return node;
+    }
+
+    while ((parent = rb_parent(node)) && node == parent->left)
+        node = parent;
+
+    return parent;
+}
+
+/*
+ * Leftmost node whose key compares >= "key" (or > "key" with "strict").
+ * Equal keys may sit on both sides of each other after rotations, so the
+ * descent keeps going left after a hit.
+ */
+static node_t *c_map_bound(c_map_t obj, void *key, bool strict)
+{
+    node_t *cur = obj->head, *bound = NULL;
+
+    while (cur) {
+        int res = obj->comparator(&cur->value, key);
+        STATS_INC(cmp);
+
+        if (res > 0 || (!strict && res == 0)) {
+            bound = cur;
+            cur = cur->left;
+        } else {
+            cur = cur->right;
+        }
+    }
+    return bound;
+}
+
+node_t *c_map_lower_bound(c_map_t obj, void *key)
+{
+    return c_map_bound(obj, key, false);
+}
+
+node_t *c_map_upper_bound(c_map_t obj, void *key)
+{
+    return c_map_bound(obj, key, true);
+}
+
+node_t *c_map_find(c_map_t obj, void *key)
+{
+    node_t *node = c_map_bound(obj, key, false);
+
+    return node && !obj->comparator(&node->value, key) ? node : NULL;
+}
+
+c_map_range_t c_map_range(c_map_t obj, void *lo, void *hi)
+{
+    c_map_range_t range = { c_map_lower_bound(obj, lo), NULL };
+
+    if (range.node) {
+        range.end = c_map_lower_bound(obj, hi);
+        if (obj->comparator(lo, hi) >= 0)
+            range.node = range.end;
+    }
+    return range;
+}
+
+node_t *c_map_range_next(c_map_range_t *range)
+{
+    node_t *node = range->node;
+
+    if (node == range->end)
+        return NULL;
+    range->node = c_map_next(node);
+    return node;
+}
+
 /* Free the c_map from memory and delete all nodes. */
 void c_map_delete(c_map_t obj)
 {
     /* Free the map itself */
-    free(obj);
+    mem_free(obj);
 }
\ No newline at end of file
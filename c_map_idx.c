@@ -0,0 +1,229 @@
+#include <stdlib.h>
+
+#include "c_map_idx.h"
+#include "memprof.h"
+#include "stats.h"
+
+#define IDX_RED 0x80000000u
+#define IDX_MAX 0x7fffffffu
+
+struct c_map_idx_node {
+    long key;
+    uint32_t left, right, up;   /* up: parent index | IDX_RED */
+    node_t *item;               /* the list node, read only when relinking */
+} __attribute__((packed, aligned(4)));
+
+struct c_map_idx_internal {
+    struct c_map_idx_node *tree;
+    uint32_t root, size, capacity;
+};
+
+#define T(i) (obj->tree[i])
+#define idx_parent(i) (T(i).up & IDX_MAX)
+#define idx_is_red(i) (T(i).up & IDX_RED)
+#define idx_set_parent(i, p) \
+    do { T(i).up = (T(i).up & IDX_RED) | (p); } while (0)
+#define idx_set_red(i) do { T(i).up |= IDX_RED; } while (0)
+#define idx_set_black(i) do { T(i).up &= IDX_MAX; } while (0)
+
+/* Double the arena, -1 (arena untouched) when full or out of memory */
+static int c_map_idx_grow(c_map_idx_t obj)
+{
+    if (obj->capacity > IDX_MAX / 2)
+        return -1;
+
+    uint32_t capacity = obj->capacity * 2;
+    struct c_map_idx_node *tree =
+        mem_realloc(obj->tree, sizeof(*obj->tree) * (capacity + 1));
+    if (!tree)
+        return -1;
+    obj->tree = tree;
+    obj->capacity = capacity;
+    return 0;
+}
+
+c_map_idx_t c_map_idx_new(size_t capacity)
+{
+    c_map_idx_t obj = mem_malloc(sizeof(struct c_map_idx_internal));
+
+    if (!obj)
+        return NULL;
+    if (capacity < 16)
+        capacity = 16;
+    if (capacity > IDX_MAX)
+        capacity = IDX_MAX;
+    obj->capacity = capacity;
+    obj->tree = mem_malloc(sizeof(*obj->tree) * (capacity + 1));
+    obj->root = obj->size = 0;
+    if (!obj->tree) {
+        mem_free(obj);
+        return NULL;
+    }
+
+    /* nil sentinel: black, no children */
+    obj->tree[0].left = obj->tree[0].right = obj->tree[0].up = 0;
+    obj->tree[0].item = NULL;
+
+    return obj;
+}
+
+/* Same shapes as c_map_rotate_left/right, on indices */
+static void c_map_idx_rotate_left(c_map_idx_t obj, uint32_t x)
+{
+    STATS_INC(rotations);
+    uint32_t y = T(x).right, up = idx_parent(x);
+
+    T(x).right = T(y).left;
+    if (T(y).left)
+        idx_set_parent(T(y).left, x);
+    idx_set_parent(y, up);
+    if (!up)
+        obj->root = y;
+    else if (T(up).left == x)
+        T(up).left = y;
+    else
+        T(up).right = y;
+    T(y).left = x;
+    idx_set_parent(x, y);
+}
+
+static void c_map_idx_rotate_right(c_map_idx_t obj, uint32_t x)
+{
+    STATS_INC(rotations);
+    uint32_t y = T(x).left, up = idx_parent(x);
+
+    T(x).left = T(y).right;
+    if (T(y).right)
+        idx_set_parent(T(y).right, x);
+    idx_set_parent(y, up);
+    if (!up)
+        obj->root = y;
+    else if (T(up).right == x)
+        T(up).right = y;
+    else
+        T(up).left = y;
+    T(y).right = x;
+    idx_set_parent(x, y);
+}
+
+static void c_map_idx_fix_colors(c_map_idx_t obj, uint32_t z)
+{
+    while (idx_is_red(idx_parent(z))) {
+        uint32_t p = idx_parent(z), g = idx_parent(p);
+
+        if (p == T(g).left) {
+            uint32_t uncle = T(g).right;
+            if (idx_is_red(uncle)) {
+                idx_set_black(p);
+                idx_set_black(uncle);
+                idx_set_red(g);
+                STATS_ADD(recolors, 3);
+                z = g;
+                continue;
+            }
+            if (z == T(p).right) {
+                z = p;
+                c_map_idx_rotate_left(obj, z);
+                p = idx_parent(z);
+            }
+            idx_set_black(p);
+            idx_set_red(g);
+            STATS_ADD(recolors, 2);
+            c_map_idx_rotate_right(obj, g);
+        } else {
+            uint32_t uncle = T(g).left;
+            if (idx_is_red(uncle)) {
+                idx_set_black(p);
+                idx_set_black(uncle);
+                idx_set_red(g);
+                STATS_ADD(recolors, 3);
+                z = g;
+                continue;
+            }
+            if (z == T(p).left) {
+                z = p;
+                c_map_idx_rotate_right(obj, z);
+                p = idx_parent(z);
+            }
+            idx_set_black(p);
+            idx_set_red(g);
+            STATS_ADD(recolors, 2);
+            c_map_idx_rotate_left(obj, g);
+        }
+    }
+    idx_set_black(obj->root);
+}
+
+uint32_t c_map_idx_insert(c_map_idx_t obj, node_t *node)
+{
+    if (obj->size == obj->capacity && c_map_idx_grow(obj))
+        return 0;
+
+    uint32_t z = ++obj->size, parent = 0, cur = obj->root;
+    long key = node->value;
+    bool left = false;
+
+    while (cur) {
+        parent = cur;
+        left = key < T(cur).key;
+        STATS_INC(cmp);
+        cur = left ? T(cur).left : T(cur).right;
+    }
+
+    T(z).key = key;
+    T(z).left = T(z).right = 0;
+    T(z).up = parent | IDX_RED;
+    T(z).item = node;
+
+    if (!parent)
+        obj->root = z;
+    else if (left)
+        T(parent).left = z;
+    else
+        T(parent).right = z;
+
+    c_map_idx_fix_colors(obj, z);
+    return z;
+}
+
+uint32_t c_map_idx_first(c_map_idx_t obj)
+{
+    uint32_t i = obj->root;
+
+    if (!i)
+        return 0;
+    while (T(i).left)
+        i = T(i).left;
+    return i;
+}
+
+uint32_t c_map_idx_next(c_map_idx_t obj, uint32_t i)
+{
+    uint32_t parent;
+
+    if (T(i).right) {
+        i = T(i).right;
+        while (T(i).left)
+            i = T(i).left;
+        return i;
+    }
+    while ((parent = idx_parent(i)) && i == T(parent).right)
+        i = parent;
+    return parent;
+}
+
+node_t *c_map_idx_node(c_map_idx_t obj, uint32_t i)
+{
+    return T(i).item;
+}
+
+size_t c_map_idx_size(c_map_idx_t obj)
+{
+    return obj->size;
+}
+
+void c_map_idx_delete(c_map_idx_t obj)
+{
+    mem_free(obj->tree);
+    mem_free(obj);
+}
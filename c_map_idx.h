@@ -0,0 +1,48 @@
+/*
+ * Red-black tree with 32-bit index links.
+ *
+ * Same job as c_map, but the tree nodes live in one arena apart from the
+ * list: left, right and parent are 32-bit indices into that arena and the
+ * color sits in the top bit of the parent index. The key is copied next to
+ * the links and the pointer back to the list node rides in the same entry,
+ * so a descent touches one 28-byte arena entry per level instead of a whole
+ * node_t, and the arena can grow with realloc since nothing points into it.
+ *
+ * This is a locality variant, it does not save memory: the 28 bytes per
+ * node come on top of the node_t, whose own c_map fields (24 bytes with
+ * c_map_bit, 32 with C_MAP_PLAIN) stay unused.
+ *
+ * Index 0 is the black nil sentinel, so up to 2^31 - 1 nodes fit.
+ * Equal keys are inserted after the existing ones (stable).
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "type.h"
+
+typedef struct c_map_idx_internal *c_map_idx_t;
+
+/* Constructor, "capacity" is only a hint. NULL if out of memory */
+c_map_idx_t c_map_idx_new(size_t capacity);
+
+/*
+ * Add node keyed by node->value, returns its index, or 0 if the arena
+ * cannot grow (out of memory or 2^31 - 1 nodes); the map is unchanged then.
+ */
+uint32_t c_map_idx_insert(c_map_idx_t obj, node_t *node);
+
+/* In-order iteration over indices, 0 is the end */
+uint32_t c_map_idx_first(c_map_idx_t obj);
+uint32_t c_map_idx_next(c_map_idx_t obj, uint32_t i);
+
+/* The list node stored at index i */
+node_t *c_map_idx_node(c_map_idx_t obj, uint32_t i);
+
+size_t c_map_idx_size(c_map_idx_t obj);
+
+/* Destructor, frees the arena only, not the list nodes */
+void c_map_idx_delete(c_map_idx_t obj);
@@ -0,0 +1,245 @@
+#include <stdlib.h>
+
+#include "dlist.h"
+#include "memprof.h"
+
+/* Singly linked view of a detached chain, "prev" is ignored while sorting */
+typedef struct {
+    struct list_head *head, *tail;
+    size_t length;
+} dlist_part_t;
+
+static inline void dlist_part_init(dlist_part_t *part)
+{
+    part->head = part->tail = NULL;
+    part->length = 0;
+}
+
+static inline void dlist_part_append(dlist_part_t *part,
+                                     struct list_head *node)
+{
+    node->next = NULL;
+    if (part->tail)
+        part->tail->next = node;
+    else
+        part->head = node;
+    part->tail = node;
+    part->length++;
+}
+
+static inline void dlist_part_join(dlist_part_t *left, dlist_part_t *right)
+{
+    if (!right->head)
+        return;
+    if (left->tail)
+        left->tail->next = right->head;
+    else
+        left->head = right->head;
+    left->tail = right->tail;
+    left->length += right->length;
+    dlist_part_init(right);
+}
+
+/* Cut the ring open, returns a NULL terminated chain */
+static struct list_head *dlist_detach(struct list_head *head)
+{
+    if (list_empty(head))
+        return NULL;
+    head->prev->next = NULL;
+    return head->next;
+}
+
+/* Close the ring again and rebuild every "prev" in one pass */
+static void dlist_attach(struct list_head *head, struct list_head *first)
+{
+    struct list_head *prev = head, *node;
+
+    for (node = first; node; node = node->next) {
+        node->prev = prev;
+        prev->next = node;
+        prev = node;
+    }
+    prev->next = head;
+    head->prev = prev;
+}
+
+/* Stable merge, ties are taken from "a" */
+static struct list_head *dlist_merge(struct list_head *a,
+                                     struct list_head *b,
+                                     dlist_key_t key)
+{
+    struct list_head *head = NULL, **tail = &head;
+
+    while (a && b) {
+        if (key(a) <= key(b)) {
+            *tail = a;
+            a = a->next;
+        } else {
+            *tail = b;
+            b = b->next;
+        }
+        tail = &(*tail)->next;
+    }
+    *tail = a ? a : b;
+    return head;
+}
+
+/*
+ * Bottom-up merge sort. pending[i] holds a sorted run of 2^i nodes, adding a
+ * node works like incrementing a binary counter.
+ */
+static struct list_head *dlist_mergesort_chain(struct list_head *list,
+                                               dlist_key_t key)
+{
+    struct list_head *pending[64] = { NULL };
+    struct list_head *result = NULL;
+    int i, max = 0;
+
+    while (list) {
+        struct list_head *cur = list;
+        list = list->next;
+        cur->next = NULL;
+
+        for (i = 0; pending[i]; i++) {
+            cur = dlist_merge(pending[i], cur, key);
+            pending[i] = NULL;
+        }
+        pending[i] = cur;
+        if (i > max)
+            max = i;
+    }
+
+    /* Older (earlier) runs live in the higher slots */
+    for (i = 0; i <= max; i++)
+        result = dlist_merge(pending[i], result, key);
+    return result;
+}
+
+void dlist_mergesort(struct list_head *head, dlist_key_t key)
+{
+    dlist_attach(head, dlist_mergesort_chain(dlist_detach(head), key));
+}
+
+static void dlist_insertsort_part(dlist_part_t *part, dlist_key_t key)
+{
+    struct list_head *sorted = NULL, *tail = NULL, *cur = part->head;
+
+    while (cur) {
+        struct list_head *node = cur, **link = &sorted;
+        long value = key(node);
+        cur = cur->next;
+
+        while (*link && key(*link) < value)
+            link = &(*link)->next;
+        node->next = *link;
+        *link = node;
+        if (!node->next)
+            tail = node;
+    }
+    part->head = sorted;
+    part->tail = tail;
+}
+
+/*
+ * c_map links node_t only, so the tree is built over one scratch array of
+ * node_t keyed by the list keys, with "next" pointing back at the entry.
+ */
+static void dlist_treesort_part(dlist_part_t *part, dlist_key_t key)
+{
+    struct list_head *cur;
+    size_t n = 0;
+
+    if (!part->head)
+        return;
+
+    node_t *shadow = mem_malloc(sizeof(node_t) * part->length);
+    c_map_t map = c_map_new(sizeof(long), sizeof(NULL), c_map_cmp_long);
+    for (cur = part->head; cur; cur = cur->next, n++) {
+        shadow[n].value = key(cur);
+        shadow[n].next = (node_t *) cur;
+        c_map_insert(map, &shadow[n], NULL);
+    }
+
+    dlist_part_t sorted;
+    dlist_part_init(&sorted);
+    for (node_t *node = c_map_first(map); node; node = c_map_next(node))
+        dlist_part_append(&sorted, (struct list_head *) node->next);
+    *part = sorted;
+
+    c_map_delete(map);
+    mem_free(shadow);
+}
+
+void dlist_treesort(struct list_head *head, dlist_key_t key)
+{
+    dlist_part_t part;
+    dlist_part_init(&part);
+
+    struct list_head *cur = dlist_detach(head);
+    while (cur) {
+        struct list_head *node = cur;
+        cur = cur->next;
+        dlist_part_append(&part, node);
+    }
+    dlist_treesort_part(&part, key);
+    dlist_attach(head, part.head);
+}
+
+static void dlist_introsort_part(dlist_part_t *part, dlist_key_t key,
+                                 int max_level, int insert)
+{
+    if (!part->head)
+        return;
+
+    if (max_level == 0) {
+        dlist_treesort_part(part, key);
+        return;
+    }
+
+    struct list_head *pivot = part->head, *p = pivot->next;
+    long value = key(pivot);
+    dlist_part_t left, right;
+
+    dlist_part_init(&left);
+    dlist_part_init(&right);
+    while (p) {
+        struct list_head *n = p;
+        p = p->next;
+        if (key(n) > value)
+            dlist_part_append(&right, n);
+        else
+            dlist_part_append(&left, n);
+    }
+
+    if (left.length < (size_t) insert)
+        dlist_insertsort_part(&left, key);
+    else
+        dlist_introsort_part(&left, key, max_level - 1, insert);
+    if (right.length < (size_t) insert)
+        dlist_insertsort_part(&right, key);
+    else
+        dlist_introsort_part(&right, key, max_level - 1, insert);
+
+    dlist_part_init(part);
+    dlist_part_join(part, &left);
+    dlist_part_append(part, pivot);
+    dlist_part_join(part, &right);
+}
+
+/* intro sort on the ring, same shape as introsort() on node_t */
+void dlist_introsort(struct list_head *head, dlist_key_t key,
+                     int max_level, int insert)
+{
+    dlist_part_t part;
+    dlist_part_init(&part);
+
+    /* the tree fallback sizes its scratch array by the part length */
+    struct list_head *cur = dlist_detach(head);
+    while (cur) {
+        struct list_head *node = cur;
+        cur = cur->next;
+        dlist_part_append(&part, node);
+    }
+    dlist_introsort_part(&part, key, max_level, insert);
+    dlist_attach(head, part.head);
+}
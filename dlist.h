@@ -0,0 +1,64 @@
+/*
+ * Kernel style circular doubly-linked list, embedded in the user struct.
+ *
+ * The sort engines work on "next" only and rebuild the "prev" links in one
+ * final pass, so they cost the same pointer writes as the node_t engines.
+ * Keys are read through a callback, usually generated by DLIST_KEY_FUNC on
+ * top of container_of.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#include "c_map_bit.h"
+
+struct list_head {
+    struct list_head *next, *prev;
+};
+
+#define LIST_HEAD_INIT(name) { &(name), &(name) }
+
+#define LIST_HEAD(name) struct list_head name = LIST_HEAD_INIT(name)
+
+static inline void INIT_LIST_HEAD(struct list_head *head)
+{
+    head->next = head->prev = head;
+}
+
+static inline void list_add_tail(struct list_head *node, struct list_head *head)
+{
+    struct list_head *prev = head->prev;
+    node->next = head;
+    node->prev = prev;
+    prev->next = node;
+    head->prev = node;
+}
+
+static inline int list_empty(const struct list_head *head)
+{
+    return head->next == head;
+}
+
+#define list_entry(ptr, type, member) container_of(ptr, type, member)
+
+#define list_for_each(pos, head) \
+    for (pos = (head)->next; pos != (head); pos = pos->next)
+
+/* Key extract callback */
+typedef long (*dlist_key_t)(struct list_head *);
+
+/*
+ * Define "static long name(struct list_head *)" returning the field "key"
+ * of the "type" that embeds the list at "member".
+ */
+#define DLIST_KEY_FUNC(name, type, member, key)                  \
+    static long name(struct list_head *__node)                   \
+    {                                                            \
+        return list_entry(__node, type, member)->key;            \
+    }
+
+void dlist_mergesort(struct list_head *head, dlist_key_t key);
+void dlist_introsort(struct list_head *head, dlist_key_t key,
+                     int max_level, int insert);
+void dlist_treesort(struct list_head *head, dlist_key_t key);
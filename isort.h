@@ -0,0 +1,203 @@
+/*
+ * Generic intrusive sort for singly linked lists of any struct.
+ *
+ * The user struct embeds a "struct slist_link" and the engines are generated
+ * per type with the ISORT_DEFINE_* macros, so the comparison is a static
+ * inline function and gets inlined into the merge and partition loops. The
+ * nodes are relinked in place, no key is copied out of the struct.
+ *
+ *   struct rec { char name[16]; long id; struct slist_link link; };
+ *   ISORT_DEFINE_KEY(rec_by_id, struct rec, link, id)
+ *
+ *   rec_by_id_mergesort(&head);
+ *   rec_by_id_introsort(&head, 32, 21);
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#include "c_map_bit.h"
+
+struct slist_link {
+    struct slist_link *next;
+};
+
+#define slist_entry(ptr, type, member) container_of(ptr, type, member)
+
+/*
+ * Core generator. "cmp" is a function or macro taking two "const type *" and
+ * returning <0, 0 or >0 like c_map_cmp_int.
+ *
+ * Generates:
+ *   void name##_mergesort(struct slist_link **list);       stable
+ *   void name##_insertsort(struct slist_link **list);      stable
+ *   void name##_introsort(struct slist_link **list, int max_level, int insert);
+ *     quick sort, insertion sort below "insert" nodes, merge sort once
+ *     "max_level" is used up
+ */
+#define ISORT_DEFINE_CMP(name, type, member, cmp)                             \
+    typedef struct {                                                          \
+        struct slist_link *head, *tail;                                       \
+        size_t length;                                                        \
+    } name##_part_t;                                                          \
+                                                                              \
+    static inline int name##_cmp(struct slist_link *a, struct slist_link *b)  \
+    {                                                                         \
+        return cmp(slist_entry(a, type, member), slist_entry(b, type, member)); \
+    }                                                                         \
+                                                                              \
+    static inline void name##_append(name##_part_t *part,                     \
+                                     struct slist_link *node)                 \
+    {                                                                         \
+        node->next = NULL;                                                    \
+        if (part->tail)                                                       \
+            part->tail->next = node;                                          \
+        else                                                                  \
+            part->head = node;                                                \
+        part->tail = node;                                                    \
+        part->length++;                                                       \
+    }                                                                         \
+                                                                              \
+    static inline void name##_join(name##_part_t *left, name##_part_t *right) \
+    {                                                                         \
+        if (!right->head)                                                     \
+            return;                                                           \
+        if (left->tail)                                                       \
+            left->tail->next = right->head;                                   \
+        else                                                                  \
+            left->head = right->head;                                         \
+        left->tail = right->tail;                                             \
+        left->length += right->length;                                        \
+    }                                                                         \
+                                                                              \
+    static inline struct slist_link *name##_merge(struct slist_link *a,       \
+                                                  struct slist_link *b)       \
+    {                                                                         \
+        struct slist_link *head = NULL, **tail = &head;                       \
+        while (a && b) {                                                      \
+            if (name##_cmp(a, b) <= 0) {                                      \
+                *tail = a;                                                    \
+                a = a->next;                                                  \
+            } else {                                                          \
+                *tail = b;                                                    \
+                b = b->next;                                                  \
+            }                                                                 \
+            tail = &(*tail)->next;                                            \
+        }                                                                     \
+        *tail = a ? a : b;                                                    \
+        return head;                                                          \
+    }                                                                         \
+                                                                              \
+    static UNUSED void name##_mergesort(struct slist_link **list)             \
+    {                                                                         \
+        struct slist_link *pending[64] = { NULL }, *result = NULL;            \
+        struct slist_link *p = *list;                                         \
+        int i, max = 0;                                                       \
+        while (p) {                                                           \
+            struct slist_link *cur = p;                                       \
+            p = p->next;                                                      \
+            cur->next = NULL;                                                 \
+            for (i = 0; pending[i]; i++) {                                    \
+                cur = name##_merge(pending[i], cur);                          \
+                pending[i] = NULL;                                            \
+            }                                                                 \
+            pending[i] = cur;                                                 \
+            if (i > max)                                                      \
+                max = i;                                                      \
+        }                                                                     \
+        for (i = 0; i <= max; i++)                                            \
+            result = name##_merge(pending[i], result);                        \
+        *list = result;                                                       \
+    }                                                                         \
+                                                                              \
+    static inline void name##_insertsort_part(name##_part_t *part)            \
+    {                                                                         \
+        struct slist_link *sorted = NULL, *tail = NULL, *cur = part->head;    \
+        while (cur) {                                                         \
+            struct slist_link *node = cur, **link = &sorted;                  \
+            cur = cur->next;                                                  \
+            while (*link && name##_cmp(*link, node) <= 0)                     \
+                link = &(*link)->next;                                        \
+            node->next = *link;                                               \
+            *link = node;                                                     \
+            if (!node->next)                                                  \
+                tail = node;                                                  \
+        }                                                                     \
+        part->head = sorted;                                                  \
+        part->tail = tail;                                                    \
+    }                                                                         \
+                                                                              \
+    static UNUSED void name##_insertsort(struct slist_link **list)            \
+    {                                                                         \
+        name##_part_t part = { *list, NULL, 0 };                              \
+        name##_insertsort_part(&part);                                        \
+        *list = part.head;                                                    \
+    }                                                                         \
+                                                                              \
+    static void name##_introsort_part(name##_part_t *part, int max_level,     \
+                                      int insert)                             \
+    {                                                                         \
+        if (!part->head)                                                      \
+            return;                                                           \
+        if (max_level == 0) {                                                 \
+            name##_mergesort(&part->head);                                    \
+            struct slist_link *t = part->head;                                \
+            while (t->next)                                                   \
+                t = t->next;                                                  \
+            part->tail = t;                                                   \
+            return;                                                           \
+        }                                                                     \
+        struct slist_link *pivot = part->head, *p = pivot->next;              \
+        name##_part_t left = { NULL, NULL, 0 }, right = { NULL, NULL, 0 };    \
+        while (p) {                                                           \
+            struct slist_link *n = p;                                         \
+            p = p->next;                                                      \
+            if (name##_cmp(n, pivot) > 0)                                     \
+                name##_append(&right, n);                                     \
+            else                                                              \
+                name##_append(&left, n);                                      \
+        }                                                                     \
+        if (left.length < (size_t) insert)                                    \
+            name##_insertsort_part(&left);                                    \
+        else                                                                  \
+            name##_introsort_part(&left, max_level - 1, insert);              \
+        if (right.length < (size_t) insert)                                   \
+            name##_insertsort_part(&right);                                   \
+        else                                                                  \
+            name##_introsort_part(&right, max_level - 1, insert);             \
+        size_t length = part->length;                                         \
+        part->head = part->tail = NULL;                                       \
+        part->length = 0;                                                     \
+        name##_join(part, &left);                                             \
+        name##_append(part, pivot);                                           \
+        name##_join(part, &right);                                            \
+        part->length = length;                                                \
+    }                                                                         \
+                                                                              \
+    static UNUSED void name##_introsort(struct slist_link **list,             \
+                                        int max_level, int insert)            \
+    {                                                                         \
+        name##_part_t part = { *list, NULL, 0 };                              \
+        name##_introsort_part(&part, max_level, insert);                      \
+        *list = part.head;                                                    \
+    }
+
+/* Compare by "key" member with the built-in < and > operators */
+#define ISORT_KEY_CMP(key, a, b) (((a)->key > (b)->key) - ((a)->key < (b)->key))
+
+#define ISORT_DEFINE_KEY(name, type, member, key)                             \
+    static inline int name##_key_cmp(const type *a, const type *b)            \
+    {                                                                         \
+        return ISORT_KEY_CMP(key, a, b);                                      \
+    }                                                                         \
+    ISORT_DEFINE_CMP(name, type, member, name##_key_cmp)
+
+/* Compare by the value an accessor "key_type accessor(const type *)" returns */
+#define ISORT_DEFINE_ACCESSOR(name, type, member, key_type, accessor)         \
+    static inline int name##_key_cmp(const type *a, const type *b)            \
+    {                                                                         \
+        key_type ka = accessor(a), kb = accessor(b);                          \
+        return (ka > kb) - (ka < kb);                                         \
+    }                                                                         \
+    ISORT_DEFINE_CMP(name, type, member, name##_key_cmp)
@@ -0,0 +1,131 @@
+#include <stdint.h>
+
+#include "lf_list.h"
+
+#define LF_MARK 1UL
+
+#define is_marked(p) ((uintptr_t) (p) & LF_MARK)
+#define get_marked(p) ((node_t *) ((uintptr_t) (p) | LF_MARK))
+#define get_unmarked(p) ((node_t *) ((uintptr_t) (p) & ~LF_MARK))
+
+static inline node_t *lf_load(node_t **ptr)
+{
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+static inline bool lf_cas(node_t **ptr, node_t *expected, node_t *desired)
+{
+    return __atomic_compare_exchange_n(ptr, &expected, desired, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+/* "right" is the first live node that must stay behind the key */
+static inline bool lf_before(node_t *node, long key, bool after_equal)
+{
+    return after_equal ? node->value <= key : node->value < key;
+}
+
+/*
+ * Find two adjacent live nodes left -> right with left before the key and
+ * right (maybe NULL) not. Marked nodes found in between are unlinked with
+ * one CAS on left->next.
+ */
+static node_t *lf_search(lf_list_t *list, long key, bool after_equal,
+                         node_t **left)
+{
+    node_t *left_next, *right, *t, *t_next;
+
+retry:
+    t = &list->head;
+    t_next = lf_load(&t->next);
+    left_next = t_next;
+    *left = t;
+
+    /* 1: walk to right, remembering the last unmarked node as left */
+    for (;;) {
+        if (!is_marked(t_next)) {
+            *left = t;
+            left_next = t_next;
+        }
+        t = get_unmarked(t_next);
+        if (!t)
+            break;
+        t_next = lf_load(&t->next);
+        if (!is_marked(t_next) && !lf_before(t, key, after_equal))
+            break;
+    }
+    right = t;
+
+    /* 2: already adjacent */
+    if (left_next == right) {
+        if (right && is_marked(lf_load(&right->next)))
+            goto retry;
+        return right;
+    }
+
+    /* 3: drop the marked nodes between left and right */
+    if (lf_cas(&(*left)->next, left_next, right)) {
+        if (right && is_marked(lf_load(&right->next)))
+            goto retry;
+        return right;
+    }
+    goto retry;
+}
+
+void lf_list_init(lf_list_t *list)
+{
+    list->head.next = NULL;
+    list->head.value = 0;
+}
+
+void lf_list_insert(lf_list_t *list, node_t *node)
+{
+    node_t *left, *right;
+
+    do {
+        right = lf_search(list, node->value, true, &left);
+        node->next = right;
+    } while (!lf_cas(&left->next, right, node));
+}
+
+node_t *lf_list_remove(lf_list_t *list, long value)
+{
+    node_t *left, *right, *right_next;
+
+    for (;;) {
+        right = lf_search(list, value, false, &left);
+        if (!right || right->value != value)
+            return NULL;
+        right_next = lf_load(&right->next);
+        if (!is_marked(right_next) &&
+            lf_cas(&right->next, right_next, get_marked(right_next)))
+            break;
+    }
+
+    /* Logically gone, try to unlink it now or let a later search do it */
+    if (!lf_cas(&left->next, right, right_next))
+        lf_search(list, right->value, false, &left);
+    return right;
+}
+
+/* First live node at or after node */
+static node_t *lf_skip(node_t *node)
+{
+    while (node) {
+        node_t *next = lf_load(&node->next);
+        if (!is_marked(next))
+            return node;
+        node = get_unmarked(next);
+    }
+    return NULL;
+}
+
+node_t *lf_list_first(lf_list_t *list)
+{
+    return lf_skip(get_unmarked(lf_load(&list->head.next)));
+}
+
+node_t *lf_list_next(node_t *node)
+{
+    return lf_skip(get_unmarked(lf_load(&node->next)));
+}
@@ -0,0 +1,37 @@
+/*
+ * Lock-free sorted list of node_t (Harris, "A Pragmatic Implementation of
+ * Non-Blocking Linked-Lists").
+ *
+ * Every link change is a CAS on "next". A node is deleted in two steps:
+ * first its own "next" is marked (lowest pointer bit), which freezes it,
+ * then it is unlinked by whoever passes by next. Insert, remove and
+ * iteration can run from any number of threads without a lock.
+ *
+ * Equal keys are allowed, a new node goes behind the existing ones.
+ *
+ * The list never frees memory. A removed node may still be read by
+ * concurrent traversals, so the caller may only free it once no other
+ * thread can be inside the list (e.g. after joining the producers).
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "type.h"
+
+typedef struct {
+    node_t head;    /* sentinel, its value is never compared */
+} lf_list_t;
+
+void lf_list_init(lf_list_t *list);
+
+/* Link node in key order, always succeeds */
+void lf_list_insert(lf_list_t *list, node_t *node);
+
+/* Remove the first node holding value, returns it or NULL */
+node_t *lf_list_remove(lf_list_t *list, long value);
+
+/* Iteration over nodes that are not deleted, NULL at the end */
+node_t *lf_list_first(lf_list_t *list);
+node_t *lf_list_next(node_t *node);
@@ -3,6 +3,7 @@
 #include <sys/stat.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 #include <math.h>
 #include <time.h>
@@ -11,191 +12,797 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdint.h>
+#include <pthread.h>
 
 #include "list.h"
 #include "type.h"
 #include "c_map_bit.h"
+#include "bptree.h"
+#include "c_map_idx.h"
+#include "sorter.h"
+#include "memprof.h"
+#include "node_pool.h"
+#include "ulist.h"
+#include "perf_counter.h"
+#include "baseline.h"
 //#include "c_map.h"
 
-void insert_sorted(node_t *entry, node_t **list)
+/* insertion sort on a handle, the node reaching the end becomes the tail */
+static void insertsort_list(list_t *list)
 {
-    while (*list && (*list)->value < entry->value)
-        list = &(*list)->next;
-    entry->next = *list;
-    *list = entry;
-}
-
-void insertsort(node_t **list) 
-{
-    node_t *sorted = NULL;
-    node_t *cur = *list;
+    node_t *sorted = NULL, *tail = NULL;
+    node_t *cur = list->head;
+    STATS_INC(insert_leaves);
     while (cur) {
         node_t *node = cur;
         cur = cur->next;
         insert_sorted(node, &sorted);
+        if (!node->next)
+            tail = node;
     }
-    *list = sorted;
+    list->head = sorted;
+    list->tail = tail;
 }
 
-void treesort(node_t **list) {
-    node_t **record = list;
-    c_map_t map = c_map_new(sizeof(long), sizeof(NULL), c_map_cmp_int);
-    while (*list) {
-        c_map_insert(map, *list, NULL);
-        list = &(*list)->next;
+void insertsort(node_t **list) 
+{
+    list_t l = { *list, NULL, 0 };
+    insertsort_list(&l);
+    *list = l.head;
+}
+
+static void treesort_list(list_t *list)
+{
+    node_t **record = &list->head, **link = &list->head;
+    c_map_t map = c_map_new(sizeof(long), sizeof(NULL), c_map_cmp_long);
+    while (*link) {
+        c_map_insert(map, *link, NULL);
+        link = &(*link)->next;
     }
-    node_t *node = c_map_first(map), *first = node;
+    node_t *node = c_map_first(map), *first = node, *last = NULL;
+    link = record;
     for ( ;node; node = c_map_next(node)) {
-        *list = node;
+        *link = last = node;
+        link = &(*link)->next;
+        STATS_INC(next_writes);
+    }
+    *link = NULL;
+    *record = first;
+    list->tail = last;
+    c_map_delete(map);
+}
+
+void treesort(node_t **list) {
+    list_t l = { *list, NULL, 0 };
+    treesort_list(&l);
+    *list = l.head;
+}
+
+/*
+ * list_sort_unique on a c_map: the first node of a key is inserted, the
+ * later ones are found in the tree and pushed on *dups.
+ */
+void unique_treesort(node_t **list, node_t **dups)
+{
+    c_map_t map = c_map_new(sizeof(long), sizeof(NULL), c_map_cmp_long);
+
+    for (node_t *node = *list, *next; node; node = next) {
+        next = node->next;
+        if (c_map_find(map, &node->value)) {
+            node->next = *dups;
+            *dups = node;
+        } else {
+            c_map_insert(map, node, NULL);
+        }
+    }
+
+    node_t **link = list;
+    for (node_t *node = c_map_first(map); node; node = c_map_next(node)) {
+        *link = node;
+        link = &node->next;
+        STATS_INC(next_writes);
+    }
+    *link = NULL;
+    c_map_delete(map);
+}
+
+/* tree sort on the B+tree index, relinked from the leaf chain */
+void bptreesort(node_t **list)
+{
+    bptree_t tree = bptree_new();
+    for (node_t *node = *list; node; node = node->next)
+        bptree_insert(tree, node);
+    *list = bptree_relink(tree);
+    bptree_delete(tree);
+}
+
+/* tree sort on the index linked red-black tree, treesort if it runs out */
+void idxtreesort(node_t **list)
+{
+    c_map_idx_t map = c_map_idx_new(1024);
+    for (node_t *node = *list; node; node = node->next) {
+        if (!map || !c_map_idx_insert(map, node)) {
+            if (map)
+                c_map_idx_delete(map);
+            treesort(list);
+            return;
+        }
+    }
+    for (uint32_t i = c_map_idx_first(map); i; i = c_map_idx_next(map, i)) {
+        *list = c_map_idx_node(map, i);
         list = &(*list)->next;
+        STATS_INC(next_writes);
     }
     *list = NULL;
-    *record = first;
-    free(map);
+    c_map_idx_delete(map);
 }
 
-/* intro sort used insertion sort and tree sort to implement */
-void introsort(node_t **list, int max_level, int insert)
+/* whole list through the streaming sorter, push and finish back to back */
+void streamsort(node_t **list)
+{
+    sorter_t sorter = sorter_new();
+    sorter_push_batch(sorter, *list);
+    *list = sorter_finish(sorter);
+    sorter_delete(sorter);
+}
+
+/* Sort the keys in an unrolled copy and write them back in order */
+void unrolledsort(node_t **list)
+{
+    ulist_t ul;
+    ulist_from_list(&ul, *list);
+    ulist_sort(&ul);
+    ulist_to_list(&ul, *list);
+    ulist_free(&ul);
+}
+
+typedef enum {
+    PARTITION_TWO_WAY,      /* <= pivot | pivot | > pivot */
+    PARTITION_THREE_WAY,    /* < pivot | == pivot | > pivot */
+} partition_mode_t;
+
+typedef enum {
+    PIVOT_HEAD,         /* first node */
+    PIVOT_MEDIAN3,      /* median of first, middle and last sampled node */
+    PIVOT_NINTHER,      /* median of three medians over 9 sampled nodes */
+    PIVOT_RESERVOIR,    /* median of a random reservoir sample */
+} pivot_mode_t;
+
+/*
+ * Knobs shared by the quick sort family, set by the benchmark driver.
+ * Thread local, so the auto engine can switch them per call: threads the
+ * driver starts get a copy of its settings.
+ */
+typedef struct {
+    partition_mode_t partition;
+    pivot_mode_t pivot;
+    bool branchless;    /* list_partition without data dependent branches */
+} sort_cfg_t;
+
+static __thread sort_cfg_t sort_cfg = { PARTITION_TWO_WAY, PIVOT_HEAD, false };
+
+/*
+ * Pivot candidates collected while a list is being built, so picking a
+ * pivot never costs an extra pass.
+ *
+ * Position sampling keeps every (mask + 1)-th node. Once the array is full,
+ * every other sample is dropped and the stride doubles, so the samples stay
+ * evenly spaced over the whole list whatever its final length is.
+ */
+#define PIVOT_SAMPLE_MAX 18
+#define PIVOT_RESERVOIR_SIZE 9
+
+typedef struct {
+    node_t *node[PIVOT_SAMPLE_MAX];
+    size_t seen, count, mask;
+} pivot_sample_t;
+
+static inline void pivot_sample_init(pivot_sample_t *s)
 {
-    if (!*list)
+    s->seen = s->count = s->mask = 0;
+}
+
+/* xorshift64*, only drives the reservoir */
+static inline uint32_t pivot_rand(void)
+{
+    static __thread uint64_t x = 88172645463325252ULL;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    return (x * 2685821657736338717ULL) >> 32;
+}
+
+static inline void pivot_sample_add(pivot_sample_t *s, node_t *n)
+{
+    size_t i = s->seen++;
+
+    if (sort_cfg.pivot == PIVOT_RESERVOIR) {
+        if (i < PIVOT_RESERVOIR_SIZE) {
+            s->node[s->count++] = n;
+        } else {
+            size_t j = ((uint64_t) pivot_rand() * (i + 1)) >> 32;
+            if (j < PIVOT_RESERVOIR_SIZE)
+                s->node[j] = n;
+        }
         return;
+    }
 
-    if (max_level == 0) {
-        treesort(list);
+    if (i & s->mask)
         return;
+    if (s->count == PIVOT_SAMPLE_MAX) {
+        for (size_t k = 0; k < PIVOT_SAMPLE_MAX / 2; k++)
+            s->node[k] = s->node[2 * k];
+        s->count = PIVOT_SAMPLE_MAX / 2;
+        s->mask = (s->mask << 1) | 1;
+        if (i & s->mask)
+            return;
     }
+    s->node[s->count++] = n;
+}
 
-    node_t *pivot = *list;
-    int value = pivot->value;
-    int l = 0, r = 0;
-    node_t *p = pivot->next;
-    pivot->next = NULL;
+static inline node_t *median3(node_t *a, node_t *b, node_t *c)
+{
+    if (a->value < b->value) {
+        if (b->value < c->value)
+            return b;
+        return a->value < c->value ? c : a;
+    }
+    if (a->value < c->value)
+        return a;
+    return b->value < c->value ? c : b;
+}
 
-    node_t *left = NULL, *right = NULL;
-    while (p) {
-        node_t *n = p;
-        p = p->next;
-        if (n->value > value) {
-            list_add_node_t(&right, n);
-            r++;
-        }
-        else {
-            list_add_node_t(&left, n);
-            l++;
+static node_t *pivot_select(pivot_sample_t *s)
+{
+    node_t **v = s->node;
+    size_t n = s->count;
+
+    if (n < 3)
+        return n ? v[0] : NULL;
+
+    if (sort_cfg.pivot == PIVOT_RESERVOIR) {
+        for (size_t i = 1; i < n; i++) {
+            node_t *key = v[i];
+            size_t j = i;
+            for (; j > 0 && v[j - 1]->value > key->value; j--)
+                v[j] = v[j - 1];
+            v[j] = key;
         }
+        return v[n / 2];
     }
-    if (l < insert)
-        insertsort(&left);
-    else 
-        introsort(&left, max_level - 1, insert);
-    if (r < insert)
-        insertsort(&right);
-    else
-        introsort(&right, max_level - 1, insert);
 
-    node_t *result = NULL;
-    list_concat(&result, left);
-    list_concat(&result, pivot); 
-    list_concat(&result, right);;
-    *list = result;
+    if (sort_cfg.pivot == PIVOT_NINTHER && n >= 9) {
+#define AT(k) v[(k) * (n - 1) / 8]
+        return median3(median3(AT(0), AT(1), AT(2)),
+                       median3(AT(3), AT(4), AT(5)),
+                       median3(AT(6), AT(7), AT(8)));
+#undef AT
+    }
+
+    return median3(v[0], v[n / 2], v[n - 1]);
 }
 
-/* quick sort with recursion version */
-void quicksort_recursion(node_t **list)
+/*
+ * Pivot of a list nobody has sampled yet (the top level call). Costs one
+ * walk, which also fills in the tail and length of the handle.
+ */
+static node_t *list_pick_pivot(list_t *list)
+{
+    if (sort_cfg.pivot == PIVOT_HEAD)
+        return list->head;
+
+    pivot_sample_t s;
+    pivot_sample_init(&s);
+    list->length = 0;
+    for (node_t *n = list->head; n; n = n->next) {
+        pivot_sample_add(&s, n);
+        list->tail = n;
+        list->length++;
+    }
+    return pivot_select(&s);
+}
+
+/*
+ * list_partition for shuffled input, where "n->value > value" is a coin
+ * flip for the branch predictor. The three output lists are kept as an
+ * array of tail links indexed by the comparison result, so every node is
+ * appended with the same instructions whichever side it goes to. Order is
+ * kept like in the branchy loop.
+ */
+static void list_partition_branchless(list_t *list, node_t *pivot,
+                                      list_t *left, list_t *mid,
+                                      list_t *right, node_t **lpivot,
+                                      node_t **rpivot)
+{
+    long value = pivot->value;
+    long three_way = sort_cfg.partition == PARTITION_THREE_WAY;
+    bool sampling = sort_cfg.pivot != PIVOT_HEAD;
+    list_t *part[3] = { left, mid, right };
+    node_t *head[3] = { NULL, NULL, NULL }, *last[3] = { NULL, NULL, NULL };
+    node_t **link[3] = { &head[0], &head[1], &head[2] };
+    size_t count[3] = { 0, 0, 0 };
+    pivot_sample_t sample[3];
+
+    if (sampling)
+        for (int k = 0; k < 3; k++)
+            pivot_sample_init(&sample[k]);
+
+    for (node_t *p = list->head, *n; p; ) {
+        n = p;
+        p = p->next;
+        if (n == pivot)
+            continue;
+        /* 0: left, 1: mid (three-way equal keys only), 2: right */
+        long side = 2 * (n->value > value) + (three_way & (n->value == value));
+        STATS_ADD(cmp, 1 + three_way);
+        *link[side] = n;
+        link[side] = &n->next;
+        last[side] = n;
+        count[side]++;
+        STATS_INC(next_writes);
+        if (sampling)
+            pivot_sample_add(&sample[side], n);
+    }
+
+    for (int k = 0; k < 3; k++) {
+        *link[k] = NULL;
+        part[k]->head = head[k];
+        part[k]->tail = last[k];
+        part[k]->length = count[k];
+    }
+    list_append(mid, pivot);
+    STATS_PARTITION(left->length, right->length);
+
+    *lpivot = sampling ? pivot_select(&sample[0]) : left->head;
+    *rpivot = sampling ? pivot_select(&sample[2]) : right->head;
+}
+
+/*
+ * Split list around pivot into left, mid and right handles. mid ends with
+ * the pivot and is already sorted: in two-way mode it is the pivot only and
+ * equal keys go left, in three-way mode every key equal to the pivot is
+ * collected there and never visited again.
+ *
+ * The pivots for left and right are picked from samples taken during this
+ * same pass and returned through lpivot and rpivot.
+ */
+static void list_partition(list_t *list, node_t *pivot, list_t *left,
+                           list_t *mid, list_t *right, node_t **lpivot,
+                           node_t **rpivot)
 {
-    if (!*list)
+    long value = pivot->value;
+    node_t *p = list->head;
+    bool three_way = sort_cfg.partition == PARTITION_THREE_WAY;
+    bool sampling = sort_cfg.pivot != PIVOT_HEAD;
+    pivot_sample_t ls, rs;
+
+    if (sort_cfg.branchless) {
+        list_partition_branchless(list, pivot, left, mid, right, lpivot,
+                                  rpivot);
         return;
+    }
 
-    node_t *pivot = *list;
-    int value = pivot->value;
-    int l = 0, r = 0;
-    node_t *p = pivot->next;
-    pivot->next = NULL;
+    list_init(left);
+    list_init(mid);
+    list_init(right);
+    if (sampling) {
+        pivot_sample_init(&ls);
+        pivot_sample_init(&rs);
+    }
 
-    node_t *left = NULL, *right = NULL;
     while (p) {
         node_t *n = p;
         p = p->next;
+        if (n == pivot)
+            continue;
+        STATS_INC(cmp);
         if (n->value > value) {
-            list_add_node_t(&right, n);
-            r++;
-        }
-        else {
-            list_add_node_t(&left, n);
-            l++;
+            list_append(right, n);
+            if (sampling)
+                pivot_sample_add(&rs, n);
+        } else if (three_way && (STATS_INC(cmp), n->value == value)) {
+            list_append(mid, n);
+        } else {
+            list_append(left, n);
+            if (sampling)
+                pivot_sample_add(&ls, n);
         }
     }
+    list_append(mid, pivot);
+    STATS_PARTITION(left->length, right->length);
+
+    *lpivot = sampling ? pivot_select(&ls) : left->head;
+    *rpivot = sampling ? pivot_select(&rs) : right->head;
+}
+
+/* Glue left, mid and right back into list with O(1) joins */
+static void list_merge_parts(list_t *list, list_t *left, list_t *mid,
+                             list_t *right)
+{
+    list_init(list);
+    list_join(list, left);
+    list_join(list, mid);
+    list_join(list, right);
+}
+
+static void introsort_list(list_t *list, node_t *pivot, int max_level,
+                           size_t insert)
+{
+    if (!list->head)
+        return;
+
+    if (max_level == 0) {
+        STATS_INC(tree_fallbacks);
+        treesort_list(list);
+        return;
+    }
+
+    list_t left, mid, right;
+    node_t *lpivot, *rpivot;
+    list_partition(list, pivot, &left, &mid, &right, &lpivot, &rpivot);
 
-    if (l < 20)
-        insertsort(&left);
+    STATS_ENTER();
+    if (left.length < insert)
+        insertsort_list(&left);
     else 
-        quicksort_recursion(&left);
-    if (r < 20)
-        insertsort(&right);
+        introsort_list(&left, lpivot, max_level - 1, insert);
+    if (right.length < insert)
+        insertsort_list(&right);
     else
-        quicksort_recursion(&right);
+        introsort_list(&right, rpivot, max_level - 1, insert);
+    STATS_LEAVE();
 
-    node_t *result = NULL;
-    list_concat(&result, left);
-    list_concat(&result, pivot); 
-    list_concat(&result, right);;
-    *list = result;
+    list_merge_parts(list, &left, &mid, &right);
+}
+
+/* intro sort used insertion sort and tree sort to implement */
+void introsort(node_t **list, int max_level, size_t insert)
+{
+    list_t l = { *list, NULL, 0 };
+    introsort_list(&l, list_pick_pivot(&l), max_level, insert);
+    *list = l.head;
+}
+
+static void quicksort_recursion_list(list_t *list, node_t *pivot)
+{
+    if (!list->head)
+        return;
+
+    list_t left, mid, right;
+    node_t *lpivot, *rpivot;
+    list_partition(list, pivot, &left, &mid, &right, &lpivot, &rpivot);
+
+    STATS_ENTER();
+    if (left.length < 20)
+        insertsort_list(&left);
+    else 
+        quicksort_recursion_list(&left, lpivot);
+    if (right.length < 20)
+        insertsort_list(&right);
+    else
+        quicksort_recursion_list(&right, rpivot);
+    STATS_LEAVE();
+
+    list_merge_parts(list, &left, &mid, &right);
+}
+
+/* quick sort with recursion version */
+void quicksort_recursion(node_t **list)
+{
+    list_t l = { *list, NULL, 0 };
+    quicksort_recursion_list(&l, list_pick_pivot(&l));
+    *list = l.head;
 }
 
 /* quick sort with no recursion version */
+/* One pending piece of the list on the quicksort_norecursion stack */
+typedef struct {
+    node_t *beg, *end, *piv;
+    bool sorted;                /* a run of keys equal to a pivot */
+} qs_segment_t;
+
 void quicksort_norecursion(node_t **list)
 {
-    int n = get_list_length(list);
-    int value;
-    int i = 0;
-    int max_level = 2 * n;
-    node_t *node_beg[max_level], *node_end[max_level];
-    node_t *result = NULL, *left = NULL, *right = NULL;
-    node_t *pivot, *p, *L, *R;
-    
-    node_beg[0] = *list;
-    node_end[0] = get_list_tail(list);
-    
+    list_t whole = { *list, NULL, 0 };
+    node_t *first = list_pick_pivot(&whole);
+    if (!whole.tail)
+        list_from_nodes(&whole, *list);
+
+    /*
+     * Every partition pushes two segments, so the stack can reach 2n + 1
+     * entries on bad pivots; it lives on the heap and grows on demand.
+     */
+    size_t cap = 64;
+    qs_segment_t *seg = mem_malloc(sizeof(*seg) * cap);
+    long i = 0;
+    node_t *result = NULL;
+    list_t left, mid, right;
+    node_t *L, *R;
+
+    if (!seg) {
+        insertsort_list(&whole);
+        *list = whole.head;
+        return;
+    }
+    seg[0] = (qs_segment_t){ whole.head, whole.tail, first, false };
+
     while (i >= 0) {
-        L = node_beg[i]; 
-        R = node_end[i];
-        if (L != R) {
-            pivot = L;
-            value = pivot->value;
-            p = pivot->next;
-            pivot->next = NULL;
-            
-            while (p) {
-                node_t *n = p;
-                p = p->next;
-                list_add_node_t(n->value > value ? &right : &left, n);
+        L = seg[i].beg;
+        R = seg[i].end;
+        if (L != R && !seg[i].sorted) {
+            if ((size_t) i + 3 > cap) {
+                qs_segment_t *grown = mem_realloc(seg, sizeof(*seg) * cap * 2);
+                if (!grown) {
+                    /* No room to split further: sort this piece in place */
+                    list_t part = { L, R, 0 };
+                    R->next = NULL;
+                    insertsort_list(&part);
+                    seg[i] = (qs_segment_t){ part.head, part.tail, NULL, true };
+                    continue;
+                }
+                seg = grown;
+                cap *= 2;
             }
+            list_partition(&(list_t){ L, R, 0 }, seg[i].piv, &left, &mid,
+                           &right, &seg[i].piv, &seg[i + 2].piv);
+
+            seg[i].beg = left.head;
+            seg[i].end = left.tail;
+            seg[i].sorted = false;
+            seg[i + 1] = (qs_segment_t){ mid.head, mid.tail, NULL, true };
+            seg[i + 2].beg = right.head;
+            seg[i + 2].end = right.tail;
+            seg[i + 2].sorted = false;
 
-            node_beg[i] = left;
-            node_end[i] = get_list_tail(&left);
-            node_beg[i + 1] = pivot;
-            node_end[i + 1] = pivot;
-            node_beg[i + 2] = right;
-            node_end[i + 2] = get_list_tail(&right);
-            
-            left = NULL;
-            right = NULL;
             i += 2;
+            STATS_DEPTH(i / 2);
         }
         else {
+            /* Single node or a run of keys equal to a pivot */
             if (L) {
-                list_add_node_t(&result, L);
+                R->next = result;
+                result = L;
+                STATS_INC(next_writes);
             }
             i--;
         }
     }
+    mem_free(seg);
     *list = result;
 }
 
+/* LSD radix sort on (value - min), "bits" wide, 8 bits per stable pass */
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+static void radixsort_list(list_t *list, long min, unsigned bits)
+{
+    list_t bucket[RADIX_BUCKETS];
+
+    for (unsigned shift = 0; shift < bits; shift += RADIX_BITS) {
+        for (int b = 0; b < RADIX_BUCKETS; b++)
+            list_init(&bucket[b]);
+        for (node_t *p = list->head, *n; p; p = n) {
+            n = p->next;
+            unsigned long key = (unsigned long) p->value - min;
+            list_append(&bucket[(key >> shift) & (RADIX_BUCKETS - 1)], p);
+        }
+        list_init(list);
+        for (int b = 0; b < RADIX_BUCKETS; b++)
+            list_join(list, &bucket[b]);
+    }
+}
+
+/* Bits needed for hi - lo */
+static unsigned key_bits(long lo, long hi)
+{
+    unsigned long range = (unsigned long) hi - lo;
+    unsigned bits = 0;
+
+    while (range >> bits)
+        bits++;
+    return bits;
+}
+
+void radixsort(node_t **list)
+{
+    list_t l = { *list, NULL, 0 };
+    long min = LONG_MAX, max = LONG_MIN;
+
+    for (node_t *n = *list; n; n = n->next) {
+        if (n->value < min)
+            min = n->value;
+        if (n->value > max)
+            max = n->value;
+    }
+    if (*list)
+        radixsort_list(&l, min, key_bits(min, max));
+    *list = l.head;
+}
+
+/*
+ * Adaptive dispatcher: one pass measures the list, then the cheapest engine
+ * for its shape runs.
+ *
+ * The pass counts the length, descents and ascents between neighbours and
+ * the key range, and keeps up to AUTO_SAMPLE evenly spaced keys in list
+ * order (same stride doubling as the pivot samples). Inversions among all
+ * sample pairs estimate presortedness, equal neighbours of the sorted
+ * sample estimate duplication.
+ */
+#define AUTO_SAMPLE 64
+
+typedef enum {
+    AUTO_SORTED,        /* nothing to do */
+    AUTO_REVERSE,       /* non-increasing, relink backwards */
+    AUTO_INSERT,
+    AUTO_RADIX,
+    AUTO_MERGE,         /* streaming sorter, cheap on long runs */
+    AUTO_THREE_WAY,     /* intro sort with three-way partition */
+    AUTO_INTRO,
+} auto_engine_t;
+
+static const char *const auto_names[] = {
+    [AUTO_SORTED] = "sorted",
+    [AUTO_REVERSE] = "reverse",
+    [AUTO_INSERT] = "insert",
+    [AUTO_RADIX] = "radix",
+    [AUTO_MERGE] = "merge",
+    [AUTO_THREE_WAY] = "three_way",
+    [AUTO_INTRO] = "intro",
+};
+
+/* Decision thresholds, set from the benchmark with -a name=value */
+static struct {
+    double small;       /* insertion sort up to this many nodes */
+    double radix_min;   /* radix sort from this many nodes ... */
+    double radix_bits;  /* ... when the key range fits in this many bits */
+    double runs;        /* merge when runs <= runs * length ... */
+    double inversions;  /* ... or sampled inversion ratio <= inversions */
+    double dups;        /* three-way partition from this duplicate ratio */
+} auto_cfg = { 24, 512, 32, 0.01, 0.05, 0.3 };
+
+static const struct {
+    const char *name;
+    double *value;
+} auto_knobs[] = {
+    { "small", &auto_cfg.small },
+    { "radix_min", &auto_cfg.radix_min },
+    { "radix_bits", &auto_cfg.radix_bits },
+    { "runs", &auto_cfg.runs },
+    { "inversions", &auto_cfg.inversions },
+    { "dups", &auto_cfg.dups },
+};
+
+/* Engine picked by the last list_sort_auto call, for the CSV output */
+static __thread auto_engine_t auto_choice;
+
+typedef struct {
+    size_t length, descents, ascents;
+    long min, max;
+    double inversions, dups;
+} auto_probe_t;
+
+static void auto_probe(node_t *list, auto_probe_t *probe)
+{
+    long sample[AUTO_SAMPLE];
+    size_t count = 0, mask = 0;
+
+    *probe = (auto_probe_t){ 0, 0, 0, LONG_MAX, LONG_MIN, 0, 0 };
+    for (node_t *n = list; n; n = n->next) {
+        size_t i = probe->length++;
+        if (n->next) {
+            probe->descents += n->next->value < n->value;
+            probe->ascents += n->next->value > n->value;
+        }
+        if (n->value < probe->min)
+            probe->min = n->value;
+        if (n->value > probe->max)
+            probe->max = n->value;
+
+        if (i & mask)
+            continue;
+        if (count == AUTO_SAMPLE) {
+            for (size_t k = 0; k < AUTO_SAMPLE / 2; k++)
+                sample[k] = sample[2 * k];
+            count = AUTO_SAMPLE / 2;
+            mask = (mask << 1) | 1;
+            if (i & mask)
+                continue;
+        }
+        sample[count++] = n->value;
+    }
+    if (count < 2)
+        return;
+
+    size_t inversions = 0, dups = 0;
+    for (size_t i = 0; i < count; i++)
+        for (size_t j = i + 1; j < count; j++)
+            inversions += sample[i] > sample[j];
+    probe->inversions = (double) inversions / (count * (count - 1) / 2);
+
+    for (size_t i = 1; i < count; i++) {
+        long key = sample[i];
+        size_t j = i;
+        for (; j > 0 && sample[j - 1] > key; j--)
+            sample[j] = sample[j - 1];
+        sample[j] = key;
+    }
+    for (size_t i = 1; i < count; i++)
+        dups += sample[i] == sample[i - 1];
+    probe->dups = (double) dups / (count - 1);
+}
+
+static auto_engine_t auto_decide(const auto_probe_t *p)
+{
+    if (p->length <= auto_cfg.small)
+        return AUTO_INSERT;
+    if (!p->descents)
+        return AUTO_SORTED;
+    if (!p->ascents)
+        return AUTO_REVERSE;
+    if (p->length >= auto_cfg.radix_min &&
+        key_bits(p->min, p->max) <= auto_cfg.radix_bits)
+        return AUTO_RADIX;
+    if (p->descents + 1 <= auto_cfg.runs * p->length ||
+        p->inversions <= auto_cfg.inversions)
+        return AUTO_MERGE;
+    if (p->dups >= auto_cfg.dups)
+        return AUTO_THREE_WAY;
+    return AUTO_INTRO;
+}
+
+void list_sort_auto(node_t **list)
+{
+    auto_probe_t probe;
+    auto_probe(*list, &probe);
+    auto_choice = auto_decide(&probe);
+
+    list_t l = { *list, NULL, 0 };
+    switch (auto_choice) {
+    case AUTO_SORTED:
+        break;
+    case AUTO_REVERSE: {
+        node_t *prev = NULL;
+        for (node_t *n = *list, *next; n; n = next) {
+            next = n->next;
+            n->next = prev;
+            prev = n;
+        }
+        l.head = prev;
+        break;
+    }
+    case AUTO_INSERT:
+        insertsort_list(&l);
+        break;
+    case AUTO_RADIX:
+        radixsort_list(&l, probe.min, key_bits(probe.min, probe.max));
+        break;
+    case AUTO_MERGE:
+        streamsort(&l.head);
+        break;
+    case AUTO_THREE_WAY:
+    case AUTO_INTRO: {
+        /* sampled pivots whatever the benchmark picked for the others */
+        sort_cfg_t saved = sort_cfg;
+        sort_cfg.pivot = PIVOT_NINTHER;
+        sort_cfg.partition = auto_choice == AUTO_THREE_WAY
+                                 ? PARTITION_THREE_WAY
+                                 : PARTITION_TWO_WAY;
+        l.tail = NULL;
+        introsort_list(&l, list_pick_pivot(&l), 2 * key_bits(0, probe.length),
+                       21);
+        sort_cfg = saved;
+        break;
+    }
+    }
+    *list = l.head;
+}
+
 /* Verify if list is order */
 static bool list_is_ordered(node_t *list) {
     bool first = true;
-    int value;
+    long value;
     while (list) {
         if (first) {
             value = list->value;
@@ -251,70 +858,685 @@ void shuffle(int *array, size_t n)
     }
 }
 
+/* Input distributions, filled into array before building the list */
+typedef enum {
+    DIST_SHUFFLE,   /* permutation of 0..n-1 */
+    DIST_SORTED,
+    DIST_REVERSE,
+    DIST_FEW,       /* shuffled, only 16 distinct keys */
+    DIST_EQUAL,     /* every key is the same */
+} dist_t;
+
+static const char *dist_names[] = {
+    [DIST_SHUFFLE] = "shuffle",
+    [DIST_SORTED] = "sorted",
+    [DIST_REVERSE] = "reverse",
+    [DIST_FEW] = "few",
+    [DIST_EQUAL] = "equal",
+};
+
+static void fill_array(int *array, size_t n, dist_t dist)
+{
+    for (size_t i = 0; i < n; ++i) {
+        switch (dist) {
+        case DIST_REVERSE:
+            array[i] = n - 1 - i;
+            break;
+        case DIST_FEW:
+            array[i] = i % 16;
+            break;
+        case DIST_EQUAL:
+            array[i] = 0;
+            break;
+        default:
+            array[i] = i;
+        }
+    }
+    if (dist == DIST_SHUFFLE || dist == DIST_FEW)
+        shuffle(array, n);
+}
+
+static const char *pivot_names[] = {
+    [PIVOT_HEAD] = "head",
+    [PIVOT_MEDIAN3] = "median3",
+    [PIVOT_NINTHER] = "ninther",
+    [PIVOT_RESERVOIR] = "reservoir",
+};
+
+static int max_level = 32;
+static size_t insert = 21;
+
+/* Nodes the unique engines dropped, checked and freed by the driver */
+static __thread node_t *dropped;
+
+static void unique_bench(node_t **list)
+{
+    list_sort_unique(list, &dropped);
+}
+
+static void unique_tree_bench(node_t **list)
+{
+    unique_treesort(list, &dropped);
+}
+
+/* Deal the list round robin into "shards" lists, sort each, merge them */
+#define SHARDS 16
+
+static int shards = SHARDS;
+
+static void shard_bench(node_t **list)
+{
+    node_t *heads[shards], **tails[shards];
+    int i;
+
+    for (i = 0; i < shards; i++)
+        tails[i] = &heads[i];
+    i = 0;
+    for (node_t *node = *list; node; node = node->next) {
+        *tails[i] = node;
+        tails[i] = &node->next;
+        i = i + 1 == shards ? 0 : i + 1;
+    }
+    for (i = 0; i < shards; i++) {
+        *tails[i] = NULL;
+        introsort(&heads[i], max_level, insert);
+    }
+    *list = list_merge_k(heads, shards);
+}
+
+static void introsort_bench(node_t **list)
+{
+    introsort(list, max_level, insert);
+}
+
+static const struct {
+    const char *name;
+    void (*sort)(node_t **list);
+    bool unique;        /* equal keys are dropped */
+} engines[] = {
+    { "intro", introsort_bench, false },
+    { "tree", treesort, false },
+    { "qs_norec", quicksort_norecursion, false },
+    { "qs_rec", quicksort_recursion, false },
+    { "insert", insertsort, false },
+    { "bptree", bptreesort, false },
+    { "idxtree", idxtreesort, false },
+    { "stream", streamsort, false },
+    { "unrolled", unrolledsort, false },
+    { "radix", radixsort, false },
+    { "auto", list_sort_auto, false },
+    { "shard", shard_bench, false },
+    { "unique", unique_bench, true },
+    { "unique_tree", unique_tree_bench, true },
+};
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+/* Where the list nodes live: one malloc each or a 4 KB / 2 MB page pool */
+typedef enum {
+    PAGES_MALLOC,
+    PAGES_4K,
+    PAGES_2M,
+} pages_t;
+
+static const char *const pages_names[] = {
+    [PAGES_MALLOC] = "malloc",
+    [PAGES_4K] = "4k",
+    [PAGES_2M] = "2m",
+};
+
+/* List of @array, nodes from @pool in list order or malloc'ed if NULL */
+static node_t *make_list(const int *array, size_t n, node_pool_t pool)
+{
+    node_t *list = NULL, **tail = &list;
+
+    if (!pool) {
+        for (size_t i = n; i--; )
+            list = list_make_node_t(list, array[i]);
+        return list;
+    }
+    for (size_t i = 0; i < n; i++) {
+        node_t *node = node_pool_alloc(pool);
+        node->value = array[i];
+        *tail = node;
+        tail = &node->next;
+    }
+    *tail = NULL;
+    return list;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-t times] [-n count] [-d dist] [-p 2|3] [-P pivot] "
+            "[-l max_level] [-i insert] [-k shards] [-b] [-H pages] [-R] [-a name=value] [-c] "
+            "[-S file] [-B file] [-T percent] [-M threads] [engine ...]\n"
+            "  dist   : shuffle sorted reverse few equal\n"
+            "  pivot  : head median3 ninther reservoir\n"
+            "  pages  : malloc 4k 2m both (node storage, both runs every "
+            "engine\n"
+            "           on 4k and 2m pools with the same input)\n"
+            "  engine : intro tree qs_norec qs_rec insert bptree idxtree\n"
+            "           stream unrolled radix auto shard unique unique_tree\n"
+            "one line per run, one column (ns) per engine\n"
+            "-M: threads[,threads...] multi-tenant mode, each thread runs -t "
+            "sorts of\n"
+            "    its own -n node lists (-t >= 1); prints sorts/s and "
+            "latency\n"
+            "    percentiles in us, - when there are too few sorts for one\n"
+            "-S: save median, CI and counters per engine into a baseline "
+            "file\n"
+            "-B: compare against a baseline file, exit 2 on regressions "
+            "over -T\n"
+            "    percent (default 5)\n"
+            "-k: lists the shard engine deals the input into, each is "
+            "intro sorted\n"
+            "    and the sorted shards are merged with a loser tree "
+            "(default %d)\n"
+            "-b: branchless partition loop for the quick sort family\n"
+            "-a: auto engine threshold: small radix_min radix_bits runs "
+            "inversions dups\n"
+            "-R: copy the sorted nodes into a contiguous pool before the "
+            "walk\n"
+            "-c: CSV, one row per run and engine (with counters when built "
+            "with -DSORT_STATS), sort, relocation and walk times\n",
+            prog, SHARDS);
+    exit(1);
+}
+
+#ifdef SORT_MEMPROF
+static struct mem_report mem_report;
+#endif
+
+/* Cost of the optional relocation and of one walk over the sorted list */
+static long relocate_ns, walk_ns;
+
+/* Branch mispredictions of the sort itself, -1 without a usable PMU */
+static perf_counter_t branch_counter;
+static long long branch_misses;
+
+static long list_walk(const node_t *list)
+{
+    long sum = 0;
+
+    for (; list; list = list->next)
+        sum += list->value;
+    return sum;
+}
+
+struct sort_call {
+    void (*sort)(node_t **list);
+    node_t **list;
+    struct timespec t1, t2;
+    sort_cfg_t cfg;             /* in */
+    auto_engine_t choice;       /* out, thread locals of the sorting thread */
+    node_t *dropped;
+};
+
+static void sort_call_run(void *arg)
+{
+    struct sort_call *call = arg;
+
+    sort_cfg = call->cfg;
+    STATS_RESET();
+    perf_counter_start(branch_counter);
+    clock_gettime(CLOCK_MONOTONIC, &call->t1);
+    call->sort(call->list);
+    clock_gettime(CLOCK_MONOTONIC, &call->t2);
+    branch_misses = perf_counter_stop(branch_counter);
+    call->choice = auto_choice;
+    call->dropped = dropped;
+    dropped = NULL;
+}
+
+/* Time one sort, in memory mode on its own measured thread */
+static time_t run_sort(void (*sort)(node_t **list), node_t **list)
+{
+    struct sort_call call = { .sort = sort, .list = list, .cfg = sort_cfg };
+
+#ifdef SORT_MEMPROF
+    mem_run(sort_call_run, &call, &mem_report);
+#else
+    sort_call_run(&call);
+#endif
+    auto_choice = call.choice;
+    dropped = call.dropped;
+    return diff_in_ns(call.t1, call.t2);
+}
+
+/*
+ * Multi-tenant mode: every thread builds, sorts and frees its own lists
+ * back to back, the way many independent small sorts share one box. The
+ * latency of one sort covers the build and the free too, that is where
+ * the malloc traffic contends.
+ */
+struct tenant {
+    pthread_t thread;
+    sort_cfg_t cfg;
+    void (*sort)(node_t **list);
+    size_t count, sorts;
+    dist_t dist;
+    pages_t pages;
+    long *latency;              /* ns, one per sort */
+};
+
+static void *tenant_run(void *arg)
+{
+    struct tenant *t = arg;
+    int *array = malloc(sizeof(int) * t->count);
+
+    sort_cfg = t->cfg;
+    fill_array(array, t->count, t->dist);
+    for (size_t i = 0; i < t->sorts; i++) {
+        struct timespec t0, t1, t2, t3;
+
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        node_pool_t pool = NULL;
+        if (t->pages != PAGES_MALLOC)
+            pool = node_pool_new(t->count, t->pages == PAGES_2M
+                                               ? NODE_POOL_2M
+                                               : NODE_POOL_4K);
+        node_t *list = make_list(array, t->count, pool);
+        t->sort(&list);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+
+        assert(list_is_ordered(list));
+
+        clock_gettime(CLOCK_MONOTONIC, &t2);
+        if (pool) {
+            node_pool_delete(pool);
+        } else {
+            if (list)
+                list_free(&list);
+            if (dropped)
+                list_free(&dropped);
+        }
+        dropped = NULL;
+        clock_gettime(CLOCK_MONOTONIC, &t3);
+        t->latency[i] = diff_in_ns(t0, t1) + diff_in_ns(t2, t3);
+    }
+    free(array);
+    return NULL;
+}
+
+/* A latency in us, "-" for a percentile the sample cannot resolve */
+static void print_us(long ns)
+{
+    if (ns < 0)
+        printf(" -");
+    else
+        printf(" %.1f", ns / 1e3);
+}
+
+/* One line per thread count: throughput and latency percentiles */
+static void tenants_bench(const char *engine, void (*sort)(node_t **list),
+                          size_t nthreads, size_t count, size_t sorts,
+                          dist_t dist, pages_t pages)
+{
+    struct tenant *t = calloc(nthreads, sizeof(struct tenant));
+    long *latency = malloc(sizeof(long) * nthreads * sorts);
+    struct timespec t0, t1;
+
+    assert(t && latency);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (size_t i = 0; i < nthreads; i++) {
+        t[i] = (struct tenant){ .cfg = sort_cfg, .sort = sort,
+                                .count = count, .sorts = sorts, .dist = dist,
+                                .pages = pages,
+                                .latency = &latency[i * sorts] };
+        if (pthread_create(&t[i].thread, NULL, tenant_run, &t[i])) {
+            perror("pthread_create");
+            exit(1);
+        }
+    }
+    for (size_t i = 0; i < nthreads; i++)
+        pthread_join(t[i].thread, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    size_t total = nthreads * sorts;
+    double wall = diff_in_ns(t0, t1);
+    qsort(latency, total, sizeof(long), bench_cmp_long);
+    printf("%s %zu %zu %zu %.1f %.1f", engine, nthreads, count, total,
+           wall / 1e6, total / (wall / 1e9));
+    print_us(bench_percentile(latency, total, 500));
+    print_us(bench_percentile(latency, total, 990));
+    print_us(bench_percentile(latency, total, 999));
+    print_us(bench_percentile(latency, total, 1000));
+    printf("\n");
+    free(latency);
+    free(t);
+}
+
+static void csv_header(void)
+{
+    printf("run,engine,chosen,dist,n,pages,ns,relocate_ns,walk_ns,"
+           "branch_misses");
+#ifdef SORT_STATS
+    printf(",cmp,next_writes,max_depth,tree_fallbacks,insert_leaves,"
+           "rotations,recolors");
+    for (int b = 0; b < STATS_IMBALANCE_BUCKETS; b++)
+        printf(",imb%d", b);
+#endif
+#ifdef SORT_MEMPROF
+    printf(",rss_base_kb,rss_peak_kb,stack_bytes,allocs,frees,heap_peak,"
+           "bytes_per_node");
+#endif
+    printf("\n");
+}
+
+static void csv_row(size_t run_id, const char *engine, const char *dist,
+                    size_t n, const char *pages, long ns)
+{
+    /* what the auto engine dispatched to, the engine itself otherwise */
+    const char *chosen = strcmp(engine, "auto") ? engine
+                                                 : auto_names[auto_choice];
+
+    printf("%zu,%s,%s,%s,%zu,%s,%ld,%ld,%ld,%lld", run_id, engine, chosen,
+           dist, n, pages, ns, relocate_ns, walk_ns, branch_misses);
+#ifdef SORT_STATS
+    printf(",%lu,%lu,%lu,%lu,%lu,%lu,%lu", sort_stats.cmp,
+           sort_stats.next_writes, sort_stats.max_depth,
+           sort_stats.tree_fallbacks, sort_stats.insert_leaves,
+           sort_stats.rotations, sort_stats.recolors);
+    for (int b = 0; b < STATS_IMBALANCE_BUCKETS; b++)
+        printf(",%lu", sort_stats.imbalance[b]);
+#endif
+#ifdef SORT_MEMPROF
+    /* extra memory the engine needs on top of the list, per node */
+    printf(",%ld,%ld,%zu,%lu,%lu,%zu,%.2f", mem_report.rss_base_kb,
+           mem_report.rss_peak_kb, mem_report.stack_bytes, mem_report.allocs,
+           mem_report.frees, mem_report.heap_peak,
+           n ? (double) (mem_report.heap_peak + mem_report.stack_bytes) / n
+             : 0.0);
+#endif
+    printf("\n");
+}
+
+static int lookup(const char *name, const char *const *names, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        if (names[i] && !strcmp(name, names[i]))
+            return i;
+    return -1;
+}
+
 int main(int argc, char **argv) {
 
-    size_t times = 1000;
+    size_t times = 1000, count = 100000;
+    dist_t dist = DIST_SHUFFLE;
+    bool csv = false, relocate = false;
+    pages_t pages[2] = { PAGES_MALLOC };
+    size_t npages = 1;
+    const char *save_path = NULL, *base_path = NULL;
+    size_t tenants[32], ntenants = 0;
+    double threshold = 5;
+    int opt;
 
-    struct timespec tt1, tt2;
     time_t time = 0;
 
-    //int max_level = 32, insert = 21;
-    //node_t *list1 = NULL, *list2 = NULL, *list3 = NULL, *list4 = NULL;
+    while ((opt = getopt(argc, argv, "t:n:d:p:P:l:i:k:bH:Ra:S:B:T:M:ch")) != -1) {
+        switch (opt) {
+        case 't':
+            times = strtoul(optarg, NULL, 0);
+            break;
+        case 'n':
+            count = strtoul(optarg, NULL, 0);
+            break;
+        case 'd':
+            if ((opt = lookup(optarg, dist_names, ARRAY_SIZE(dist_names))) < 0)
+                usage(argv[0]);
+            dist = opt;
+            break;
+        case 'p':
+            if (strcmp(optarg, "2") && strcmp(optarg, "3"))
+                usage(argv[0]);
+            sort_cfg.partition = optarg[0] == '3' ? PARTITION_THREE_WAY
+                                                  : PARTITION_TWO_WAY;
+            break;
+        case 'P':
+            if ((opt = lookup(optarg, pivot_names,
+                              ARRAY_SIZE(pivot_names))) < 0)
+                usage(argv[0]);
+            sort_cfg.pivot = opt;
+            break;
+        case 'k':
+            shards = atoi(optarg);
+            if (shards < 1)
+                usage(argv[0]);
+            break;
+        case 'H':
+            if (!strcmp(optarg, "both")) {
+                pages[0] = PAGES_4K;
+                pages[1] = PAGES_2M;
+                npages = 2;
+                break;
+            }
+            if ((opt = lookup(optarg, pages_names,
+                              ARRAY_SIZE(pages_names))) < 0)
+                usage(argv[0]);
+            pages[0] = opt;
+            npages = 1;
+            break;
+        case 'M':
+            for (char *tok = strtok(optarg, ","); tok && ntenants < 32;
+                 tok = strtok(NULL, ","))
+                if ((tenants[ntenants] = strtoul(tok, NULL, 0)))
+                    ntenants++;
+            break;
+        case 'S':
+            save_path = optarg;
+            break;
+        case 'B':
+            base_path = optarg;
+            break;
+        case 'T':
+            threshold = strtod(optarg, NULL);
+            break;
+        case 'b':
+            sort_cfg.branchless = true;
+            break;
+        case 'R':
+            relocate = true;
+            break;
+        case 'a': {
+            char *eq = strchr(optarg, '=');
+            if (!eq)
+                usage(argv[0]);
+            *eq = '\0';
+            size_t k;
+            for (k = 0; k < ARRAY_SIZE(auto_knobs); k++)
+                if (!strcmp(optarg, auto_knobs[k].name))
+                    break;
+            if (k == ARRAY_SIZE(auto_knobs))
+                usage(argv[0]);
+            *auto_knobs[k].value = strtod(eq + 1, NULL);
+            break;
+        }
+        case 'c':
+            csv = true;
+            break;
+        case 'l':
+            max_level = atoi(optarg);
+            break;
+        case 'i':
+            insert = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+
+    /* Engines to run, default to tree sort like the original benchmark */
+    size_t run[ARRAY_SIZE(engines)], nrun = 0;
+    for (int a = optind; a < argc && nrun < ARRAY_SIZE(run); a++) {
+        size_t e;
+        for (e = 0; e < ARRAY_SIZE(engines); e++)
+            if (!strcmp(argv[a], engines[e].name))
+                break;
+        if (e == ARRAY_SIZE(engines))
+            usage(argv[0]);
+        run[nrun++] = e;
+    }
+    if (!nrun)
+        run[nrun++] = 1;
+
+    if (ntenants) {
+        if (!times)
+            usage(argv[0]);
+        printf("engine threads n sorts wall_ms sorts_per_s p50_us p99_us "
+               "p999_us max_us\n");
+        for (size_t e = 0; e < nrun; e++)
+            for (size_t k = 0; k < ntenants; k++)
+                tenants_bench(engines[run[e]].name, engines[run[e]].sort,
+                              tenants[k], count, times, dist, pages[0]);
+        return 0;
+    }
+
+    int *test_arr = malloc(sizeof(int) * count);
+
+    /* Per engine and backing samples for the baseline summaries */
+    size_t ncase = nrun * npages;
+    long *ns = malloc(sizeof(long) * ncase * times);
+    long long *cmps = malloc(sizeof(long long) * ncase * times);
+    long long *misses = malloc(sizeof(long long) * ncase * times);
+    assert(ns && cmps && misses);
+
+    if (csv)
+        csv_header();
+    if (csv || save_path || base_path) {
+        branch_counter = perf_counter_new(PERF_TYPE_HARDWARE,
+                                          PERF_COUNT_HW_BRANCH_MISSES);
+        if (!branch_counter)
+            fprintf(stderr, "no branch-misses counter, column is -1\n");
+    }
+
+    for (size_t run_id = 0; run_id < times; run_id++) {
+        fill_array(test_arr, count, dist);
+
+        for (size_t e = 0; e < nrun; e++) {
+            for (size_t p = 0; p < npages; p++) {
+                node_pool_t pool = NULL;
+                if (pages[p] != PAGES_MALLOC) {
+                    pool = node_pool_new(count, pages[p] == PAGES_2M
+                                                    ? NODE_POOL_2M
+                                                    : NODE_POOL_4K);
+                    assert(pool);
+                    if (!run_id && !e && pages[p] == PAGES_2M)
+                        fprintf(stderr, "2m pool backed by %s\n",
+                                node_pool_backing(pool));
+                }
+                node_t *list = make_list(test_arr, count, pool);
+
+                time = run_sort(engines[run[e]].sort, &list);
+
+                size_t ndropped = dropped ? get_list_length(&dropped) : 0;
+                if (dropped && !pool)
+                    list_free(&dropped);
+                dropped = NULL;
 
-    while (times--) {
-        
-        size_t count = 100000;
-        node_t *list1 = NULL, *list3 = NULL; 
-        node_t *list2 = NULL; //tree_sort
+                struct timespec tt1, tt2;
+                node_pool_t moved = NULL;
+                relocate_ns = 0;
+                if (relocate) {
+                    clock_gettime(CLOCK_MONOTONIC, &tt1);
+                    moved = node_pool_new(count, pages[p] == PAGES_2M
+                                                     ? NODE_POOL_2M
+                                                     : NODE_POOL_4K);
+                    assert(moved);
+                    node_t *old = NULL;
+                    int failed = node_pool_relocate(moved, &list, &old);
+                    clock_gettime(CLOCK_MONOTONIC, &tt2);
+                    relocate_ns = diff_in_ns(tt1, tt2);
+                    /* the list stays where it was, the walk is not moved */
+                    if (failed)
+                        fprintf(stderr, "node pool full, list not moved\n");
+                    if (!pool && old)
+                        list_free(&old);
+                }
+                clock_gettime(CLOCK_MONOTONIC, &tt1);
+                volatile long sink = list_walk(list);
+                (void) sink;
+                clock_gettime(CLOCK_MONOTONIC, &tt2);
+                walk_ns = diff_in_ns(tt1, tt2);
 
-        int *test_arr = malloc(sizeof(int) * count);
+                size_t sample = (e * npages + p) * times + run_id;
+                ns[sample] = time;
+#ifdef SORT_STATS
+                cmps[sample] = sort_stats.cmp;
+#else
+                cmps[sample] = -1;
+#endif
+                misses[sample] = branch_misses;
+                if (csv)
+                    csv_row(run_id, engines[run[e]].name, dist_names[dist],
+                            count, pages_names[pages[p]], time);
+                else
+                    printf("%ld%c", time,
+                           e + 1 == nrun && p + 1 == npages ? '\n' : ' ');
 
-        for (int i = 0; i < count; ++i) {
-            test_arr[i] = i;
+                assert(list_is_ordered(list));
+                assert(get_list_length(&list) + ndropped == count);
+                for (node_t *n = list; engines[run[e]].unique && n && n->next;
+                     n = n->next)
+                    assert(n->value < n->next->value);
+                if (moved)
+                    node_pool_delete(moved);
+                else if (!pool && list)
+                    list_free(&list);
+                if (pool)
+                    node_pool_delete(pool);
+            }
         }
-        shuffle(test_arr, count);
+    }
+    perf_counter_delete(branch_counter);
+    free(test_arr);
+
+    int status = 0;
+    if (save_path || base_path) {
+        bench_case_t *cases = calloc(ncase, sizeof(bench_case_t));
+        char config[BENCH_NAME], kflag[16] = "";
+        if (shards != SHARDS)   /* keeps older baselines' keys valid */
+            snprintf(kflag, sizeof(kflag), "-k%d", shards);
+        snprintf(config, sizeof(config), "%s-p%d-l%d-i%zu%s%s",
+                 pivot_names[sort_cfg.pivot],
+                 sort_cfg.partition == PARTITION_THREE_WAY ? 3 : 2, max_level,
+                 insert, sort_cfg.branchless ? "-b" : "", kflag);
+
+        for (size_t e = 0; e < nrun; e++)
+            for (size_t p = 0; p < npages; p++) {
+                size_t k = e * npages + p;
+                bench_case_t *c = &cases[k];
+                snprintf(c->engine, BENCH_NAME, "%s", engines[run[e]].name);
+                snprintf(c->dist, BENCH_NAME, "%s", dist_names[dist]);
+                snprintf(c->pages, BENCH_NAME, "%s", pages_names[pages[p]]);
+                snprintf(c->config, BENCH_NAME, "%s", config);
+                c->n = count;
+                bench_summarize(c, &ns[k * times], times);
+                c->cmp = bench_median_count(&cmps[k * times], times);
+                c->branch_misses = bench_median_count(&misses[k * times],
+                                                      times);
+            }
 
-        while (count--) {
-            //list1 = list_make_node_t(list1, test_arr[count]);
-            list2 = list_make_node_t(list2, test_arr[count]);
-            //list3 = list_make_node_t(list3, test_arr[count]);
-            //list4 = list_make_node_t(list4, test_arr[count]);
+        if (base_path) {
+            bench_case_t *base;
+            long nbase = baseline_load(base_path, &base);
+            if (nbase < 0) {
+                perror(base_path);
+                status = 1;
+            } else if (baseline_compare(base, nbase, cases, ncase, threshold,
+                                        stderr)) {
+                status = 2;
+            }
+            free(base);
+        }
+        if (save_path && baseline_save(save_path, cases, ncase)) {
+            perror(save_path);
+            status = 1;
         }
-        /*
-        clock_gettime(CLOCK_MONOTONIC, &tt1);
-        introsort(&list1, max_level, insert);
-        clock_gettime(CLOCK_MONOTONIC, &tt2);
-        time = diff_in_ns(tt1, tt2);
-        printf("%ld ", time);
-        */
-        clock_gettime(CLOCK_MONOTONIC, &tt1);
-        treesort(&list2);
-        clock_gettime(CLOCK_MONOTONIC, &tt2);
-        time = diff_in_ns(tt1, tt2);
-        printf("%ld\n", time);
-        /*
-        clock_gettime(CLOCK_MONOTONIC, &tt1);
-        quicksort_recursion(&list3);
-        clock_gettime(CLOCK_MONOTONIC, &tt2);
-        time = diff_in_ns(tt1, tt2);
-        printf("%ld ", time);
-        
-        clock_gettime(CLOCK_MONOTONIC, &tt1);
-        quicksort_norecursion(&list4);
-        clock_gettime(CLOCK_MONOTONIC, &tt2);
-        time = diff_in_ns(tt1, tt2);
-        printf("%ld\n", time);
-        */
-        //assert(list_is_ordered(list1));
-        assert(list_is_ordered(list2));
-        //assert(list_is_ordered(list3));
-        //assert(list_is_ordered(list4));
-        
-        //list_free(&list1);
-        list_free(&list2);
-        //list_free(&list3);
-        //list_free(&list4);
-        
-        free(test_arr);
-    }
-}        
+        free(cases);
+    }
+    free(ns);
+    free(cmps);
+    free(misses);
+    return status;
+}
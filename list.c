@@ -1,11 +1,196 @@
+#include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "c_map.h"
+#include "list.h"
+#include "memprof.h"
+
+#ifdef SORT_STATS
+struct sort_stats sort_stats;
+#endif
+
+/* Wrap an existing chain into a handle, one walk to find tail and length */
+void list_from_nodes(list_t *list, node_t *head)
+{
+    list_init(list);
+    list->head = head;
+    if (!head)
+        return;
+    list->length = 1;
+    while (head->next) {
+        head = head->next;
+        list->length++;
+    }
+    list->tail = head;
+}
+
+void insert_sorted(node_t *entry, node_t **list)
+{
+    while (*list && (STATS_INC(cmp), (*list)->value < entry->value))
+        list = &(*list)->next;
+    entry->next = *list;
+    *list = entry;
+    STATS_ADD(next_writes, 2);
+}
+
+node_t *list_merge(node_t *a, node_t *b)
+{
+    node_t *head = NULL, **tail = &head;
+
+    while (a && b) {
+        STATS_INC(cmp);
+        if (a->value <= b->value) {
+            *tail = a;
+            a = a->next;
+        } else {
+            *tail = b;
+            b = b->next;
+        }
+        tail = &(*tail)->next;
+        STATS_INC(next_writes);
+    }
+    *tail = a ? a : b;
+    return head;
+}
+
+/* Does the head of list "a" leave the tournament before that of "b" */
+static inline bool merge_beats(node_t **lists, size_t a, size_t b)
+{
+    if (!lists[a] || !lists[b])
+        return lists[a] || (!lists[b] && a < b);
+    STATS_INC(cmp);
+    return lists[a]->value < lists[b]->value ||
+           (lists[a]->value == lists[b]->value && a < b);
+}
+
+/*
+ * Leaves k .. 2k - 1 are the lists, inner node i has children 2i and
+ * 2i + 1 and keeps the loser of the match between their winners; the
+ * overall winner ends up in tree[0].
+ */
+static size_t merge_build(node_t **lists, size_t *tree, size_t k, size_t i)
+{
+    if (i >= k)
+        return i - k;
+
+    size_t l = merge_build(lists, tree, k, 2 * i);
+    size_t r = merge_build(lists, tree, k, 2 * i + 1);
+    if (merge_beats(lists, l, r)) {
+        tree[i] = r;
+        return l;
+    }
+    tree[i] = l;
+    return r;
+}
+
+node_t *list_merge_k(node_t **lists, size_t k)
+{
+    if (k <= 2) {
+        node_t *head = k == 2 ? list_merge(lists[0], lists[1])
+                              : k ? lists[0] : NULL;
+        for (size_t i = 0; i < k; i++)
+            lists[i] = NULL;
+        return head;
+    }
+
+    size_t *tree = mem_malloc(sizeof(size_t) * k);
+    node_t *head = NULL, **tail = &head;
+
+    /* No room for the tree: fold pairwise, O(nk) but still stable */
+    if (!tree) {
+        for (size_t i = 0; i < k; i++) {
+            head = list_merge(head, lists[i]);
+            lists[i] = NULL;
+        }
+        return head;
+    }
+
+    tree[0] = merge_build(lists, tree, k, 1);
+    while (lists[tree[0]]) {
+        size_t win = tree[0];
+        *tail = lists[win];
+        tail = &lists[win]->next;
+        lists[win] = lists[win]->next;
+        STATS_INC(next_writes);
+
+        /* Replay the matches on the path of the leaf that moved */
+        for (size_t i = (win + k) / 2; i; i /= 2)
+            if (merge_beats(lists, tree[i], win)) {
+                size_t t = tree[i];
+                tree[i] = win;
+                win = t;
+            }
+        tree[0] = win;
+    }
+    *tail = NULL;
+    mem_free(tree);
+    return head;
+}
+
+/* list_merge keeping the node of "a" for equal keys, "b"'s go to *dups */
+static node_t *list_merge_unique(node_t *a, node_t *b, node_t **dups)
+{
+    node_t *head = NULL, **tail = &head;
+
+    while (a && b) {
+        STATS_INC(cmp);
+        if (a->value < b->value) {
+            *tail = a;
+            a = a->next;
+        } else if (STATS_INC(cmp), a->value > b->value) {
+            *tail = b;
+            b = b->next;
+        } else {
+            node_t *dup = b;
+            b = b->next;
+            dup->next = *dups;
+            *dups = dup;
+            continue;
+        }
+        tail = &(*tail)->next;
+        STATS_INC(next_writes);
+    }
+    *tail = a ? a : b;
+    return head;
+}
+
+#define UNIQUE_BINS 64
+
+void list_sort_unique(node_t **list, node_t **dups)
+{
+    node_t *bin[UNIQUE_BINS] = { NULL }, *node = *list;
+    int max = 0;
+
+    /* bin[i] holds the keys of 2^i input nodes, so never more than distinct */
+    while (node) {
+        node_t *cur = node;
+        node = node->next;
+        cur->next = NULL;
+
+        int i;
+        for (i = 0; bin[i]; i++) {
+            cur = list_merge_unique(bin[i], cur, dups);
+            bin[i] = NULL;
+        }
+        bin[i] = cur;
+        if (i > max)
+            max = i;
+    }
+
+    /* Older (larger) bins go first so their nodes win the ties */
+    node_t *result = NULL;
+    for (int i = 0; i <= max; i++)
+        if (bin[i])
+            result = list_merge_unique(bin[i], result, dups);
+    *list = result;
+}
 
 void list_add_node_t(node_t **list, node_t *node_t) 
 {
     node_t->next = *list;
     *list = node_t;
+    STATS_INC(next_writes);
 }
 
 void list_concat(node_t **left, node_t *right) 
@@ -35,7 +220,7 @@ int get_list_length(node_t **left)
 
 node_t *list_make_node_t(node_t *list, int n) 
 {
-    node_t *node = malloc(sizeof(node_t));
+    node_t *node = mem_malloc(sizeof(node_t));
     node->value = n;
     node->next = list;
     return node;
@@ -45,7 +230,7 @@ void list_free(node_t **list)
 {
     node_t *node = (*list)->next;
     while (*list) {
-        free(*list);
+        mem_free(*list);
         *list = node;
         if (node)
             node = node->next;
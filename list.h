@@ -1,10 +1,95 @@
 #pragma once
 
 #include "type.h"
+#include "stats.h"
+
+/*
+ * List handle: keeps the tail and the length next to the head so that
+ * append, concat and length are O(1) instead of walking the chain.
+ */
+typedef struct {
+    node_t *head, *tail;
+    size_t length;
+} list_t;
+
+static inline void list_init(list_t *list)
+{
+    list->head = list->tail = NULL;
+    list->length = 0;
+}
+
+/* Append node to the tail, keeps the original order */
+static inline void list_append(list_t *list, node_t *node)
+{
+    node->next = NULL;
+    STATS_INC(next_writes);
+    if (list->tail) {
+        list->tail->next = node;
+        STATS_INC(next_writes);
+    } else {
+        list->head = node;
+    }
+    list->tail = node;
+    list->length++;
+}
+
+/* Push node in front of the head */
+static inline void list_push(list_t *list, node_t *node)
+{
+    node->next = list->head;
+    STATS_INC(next_writes);
+    if (!list->tail)
+        list->tail = node;
+    list->head = node;
+    list->length++;
+}
+
+/* Move all nodes of right to the end of left, right becomes empty */
+static inline void list_join(list_t *left, list_t *right)
+{
+    if (!right->head)
+        return;
+    if (left->tail) {
+        left->tail->next = right->head;
+        STATS_INC(next_writes);
+    } else {
+        left->head = right->head;
+    }
+    left->tail = right->tail;
+    left->length += right->length;
+    list_init(right);
+}
+
+static inline size_t list_length(list_t *list)
+{
+    return list->length;
+}
+
+void list_from_nodes(list_t *list, node_t *head);
+
+void insert_sorted(node_t *entry, node_t **list);
+
+/* Stable merge of two sorted lists, ties are taken from "a" */
+node_t *list_merge(node_t *a, node_t *b);
+
+/*
+ * Stable merge of k sorted lists with a loser tree: O(n log k) comparisons
+ * and one "next" write per node. Ties are taken from the lower index. The
+ * lists[] array is used as the cursor table and ends up all NULL.
+ */
+node_t *list_merge_k(node_t **lists, size_t k);
+/*
+ * Sort and keep one node per key, the first one in input order. Every
+ * other node with an equal key is pushed on *dups as soon as it meets its
+ * twin, so the work shrinks with the number of distinct keys. Unique
+ * runs are carried in a binomial counter (the c_map version is the
+ * driver's unique_tree engine).
+ */
+void list_sort_unique(node_t **list, node_t **dups);
 
 void list_add_node_t(node_t **list, node_t *node_t);
 void list_concat(node_t **left, node_t *right);
 node_t *get_list_tail(node_t **left);
 int get_list_length(node_t **left);
 node_t *list_make_node_t(node_t *list, int n); 
-void list_free(node_t **list);
\ No newline at end of file
+void list_free(node_t **list);
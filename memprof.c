@@ -0,0 +1,197 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "memprof.h"
+
+#ifdef SORT_MEMPROF
+
+/* Virtual size of the measuring thread stack, only touched pages count */
+#define MEM_STACK_SIZE (1UL << 30)
+
+/* In front of every block: its size and the distance back to the base */
+struct mem_header {
+    size_t size, offset;
+};
+
+#define MEM_HEADER 16
+
+static struct {
+    unsigned long allocs, frees;
+    size_t live, peak;
+} mem;
+
+static inline void *mem_track(char *base, size_t offset, size_t size)
+{
+    struct mem_header *h;
+
+    if (!base)
+        return NULL;
+    h = (struct mem_header *) (base + offset - MEM_HEADER);
+    h->size = size;
+    h->offset = offset;
+    mem.allocs++;
+    mem.live += size;
+    if (mem.live > mem.peak)
+        mem.peak = mem.live;
+    return base + offset;
+}
+
+void *mem_malloc(size_t size)
+{
+    return mem_track(malloc(size + MEM_HEADER), MEM_HEADER, size);
+}
+
+void *mem_aligned_alloc(size_t align, size_t size)
+{
+    if (align < MEM_HEADER)
+        align = MEM_HEADER;
+    return mem_track(aligned_alloc(align, size + align), align, size);
+}
+
+void mem_free(void *ptr)
+{
+    struct mem_header *h;
+
+    if (!ptr)
+        return;
+    h = (struct mem_header *) ((char *) ptr - MEM_HEADER);
+    mem.frees++;
+    mem.live -= h->size;
+    free((char *) ptr - h->offset);
+}
+
+void *mem_realloc(void *ptr, size_t size)
+{
+    struct mem_header *h;
+    char *base;
+
+    if (!ptr)
+        return mem_malloc(size);
+    h = (struct mem_header *) ((char *) ptr - MEM_HEADER);
+    assert(h->offset == MEM_HEADER);
+    mem.live -= h->size;
+    mem.allocs--;   /* counted again by mem_track */
+    base = realloc((char *) ptr - MEM_HEADER, size + MEM_HEADER);
+    return mem_track(base, MEM_HEADER, size);
+}
+
+/* One "Vm...:  <n> kB" line of /proc/self/status */
+static long mem_status_kb(const char *key)
+{
+    char line[256];
+    long kb = -1;
+    size_t len = strlen(key);
+    FILE *f = fopen("/proc/self/status", "r");
+
+    if (!f)
+        return -1;
+    while (fgets(line, sizeof(line), f)) {
+        if (!strncmp(line, key, len) && line[len] == ':') {
+            kb = atol(line + len + 1);
+            break;
+        }
+    }
+    fclose(f);
+    return kb;
+}
+
+/* Writing 5 to clear_refs resets VmHWM to the current RSS */
+static void mem_reset_hwm(void)
+{
+    FILE *f = fopen("/proc/self/clear_refs", "w");
+
+    if (f) {
+        fputs("5", f);
+        fclose(f);
+    }
+}
+
+struct mem_call {
+    void (*fn)(void *);
+    void *arg;
+};
+
+static void *mem_thread(void *arg)
+{
+    struct mem_call *call = arg;
+    call->fn(call->arg);
+    return NULL;
+}
+
+/*
+ * The stack is a fresh anonymous mapping, so a page is resident only if the
+ * call reached it. Stacks grow down: the lowest resident page marks the
+ * high-water.
+ */
+static size_t mem_stack_used(char *stack, size_t size)
+{
+    size_t page = sysconf(_SC_PAGESIZE), pages = size / page, i;
+    unsigned char *vec = malloc(pages);
+
+    if (!vec || mincore(stack, size, vec)) {
+        free(vec);
+        return 0;
+    }
+    for (i = 0; i < pages && !(vec[i] & 1); i++)
+        ;
+    free(vec);
+    return (pages - i) * page;
+}
+
+static void mem_noop(void *arg)
+{
+    (void) arg;
+}
+
+/*
+ * Pages a thread uses before calling fn (thread descriptor, TLS, start
+ * frames), measured once and subtracted from every report.
+ */
+static size_t mem_stack_base = (size_t) -1;
+
+void mem_run(void (*fn)(void *), void *arg, struct mem_report *report)
+{
+    if (mem_stack_base == (size_t) -1) {
+        mem_stack_base = 0;
+        mem_run(mem_noop, NULL, report);
+        mem_stack_base = report->stack_bytes;
+    }
+
+    struct mem_call call = { fn, arg };
+    pthread_attr_t attr;
+    pthread_t thread;
+    char *stack = mmap(NULL, MEM_STACK_SIZE, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK,
+                       -1, 0);
+
+    assert(stack != MAP_FAILED);
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, stack, MEM_STACK_SIZE);
+
+    mem.allocs = mem.frees = 0;
+    mem.peak = mem.live;
+    size_t start = mem.live;
+    mem_reset_hwm();
+    report->rss_base_kb = mem_status_kb("VmRSS");
+
+    pthread_create(&thread, &attr, mem_thread, &call);
+    pthread_join(thread, NULL);
+
+    report->rss_peak_kb = mem_status_kb("VmHWM");
+    report->stack_bytes = mem_stack_used(stack, MEM_STACK_SIZE);
+    report->stack_bytes -= report->stack_bytes < mem_stack_base
+                               ? report->stack_bytes
+                               : mem_stack_base;
+    report->allocs = mem.allocs;
+    report->frees = mem.frees;
+    report->heap_peak = mem.peak - start;
+
+    pthread_attr_destroy(&attr);
+    munmap(stack, MEM_STACK_SIZE);
+}
+
+#endif
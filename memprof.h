@@ -0,0 +1,43 @@
+/*
+ * Memory accounting, compiled in with -DSORT_MEMPROF.
+ *
+ * The engines allocate through mem_malloc/mem_free and friends. Without
+ * SORT_MEMPROF these are plain malloc/free. With it, every block carries a
+ * small header holding its size, so calls, live bytes and the heap peak can
+ * be counted (not thread safe).
+ *
+ * mem_run() runs one function on a thread with a fresh stack and reports
+ * the peak RSS, the stack high-water mark and the allocator activity of
+ * that call.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#ifdef SORT_MEMPROF
+
+struct mem_report {
+    long rss_base_kb;           /* VmRSS before the call */
+    long rss_peak_kb;           /* VmHWM during the call */
+    size_t stack_bytes;         /* deepest stack use, page granular */
+    unsigned long allocs, frees;
+    size_t heap_peak;           /* max live bytes above the start level */
+};
+
+void *mem_malloc(size_t size);
+void *mem_realloc(void *ptr, size_t size);
+void *mem_aligned_alloc(size_t align, size_t size);
+void mem_free(void *ptr);
+
+void mem_run(void (*fn)(void *), void *arg, struct mem_report *report);
+
+#else
+
+#define mem_malloc(size) malloc(size)
+#define mem_realloc(ptr, size) realloc(ptr, size)
+#define mem_aligned_alloc(align, size) aligned_alloc(align, size)
+#define mem_free(ptr) free(ptr)
+
+#endif
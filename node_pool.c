@@ -0,0 +1,120 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "node_pool.h"
+
+#define HUGE_PAGE (2UL << 20)
+
+struct node_pool_internal {
+    void *map;          /* mapping as returned by mmap */
+    size_t map_size;
+    node_t *cur, *end;
+    const char *backing;
+};
+
+/* Anonymous mapping of @size bytes aligned to @align (a power of two) */
+static void *map_aligned(size_t size, size_t align)
+{
+    char *map = mmap(NULL, size + align, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED)
+        return NULL;
+
+    char *base = (char *) (((uintptr_t) map + align - 1) & ~(align - 1));
+    if (base > map)
+        munmap(map, base - map);
+    if (base + size < map + size + align)
+        munmap(base + size, map + size + align - (base + size));
+    return base;
+}
+
+node_pool_t node_pool_new(size_t nodes, node_pool_page_t page)
+{
+    node_pool_t obj = malloc(sizeof(struct node_pool_internal));
+    assert(obj);
+
+    size_t size = (nodes ? nodes : 1) * sizeof(node_t);
+    obj->map = MAP_FAILED;
+    if (page == NODE_POOL_2M) {
+        obj->map_size = (size + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1);
+        obj->map = mmap(NULL, obj->map_size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        obj->backing = "hugetlb";
+        if (obj->map == MAP_FAILED) {
+            /* no reserved huge pages, let khugepaged/the fault path do it */
+            obj->map = map_aligned(obj->map_size, HUGE_PAGE);
+            if (!obj->map)
+                obj->map = MAP_FAILED;
+            else if (madvise(obj->map, obj->map_size, MADV_HUGEPAGE))
+                obj->backing = "4k";
+            else
+                obj->backing = "thp";
+        }
+    } else {
+        obj->map_size = size;
+        obj->map = mmap(NULL, obj->map_size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (obj->map != MAP_FAILED)
+            madvise(obj->map, obj->map_size, MADV_NOHUGEPAGE);
+        obj->backing = "4k";
+    }
+    if (obj->map == MAP_FAILED) {
+        free(obj);
+        return NULL;
+    }
+
+    obj->cur = obj->map;
+    obj->end = obj->cur + nodes;
+    return obj;
+}
+
+node_t *node_pool_alloc(node_pool_t obj)
+{
+    if (obj->cur == obj->end)
+        return NULL;
+    return obj->cur++;
+}
+
+int node_pool_relocate(node_pool_t obj, node_t **list, node_t **old)
+{
+    node_t *head = NULL, **tail = &head, *start = obj->cur;
+
+    /* each copy parks its original's "left" until the whole list fits */
+    for (node_t *node = *list; node; node = node->next) {
+        if (obj->cur == obj->end) {
+            for (node_t *n = *list; n != node; n = n->next)
+                n->left = n->left->left;
+            obj->cur = start;
+            return -1;
+        }
+        node_t *copy = obj->cur++;
+        memset(copy, 0, sizeof(*copy));
+        copy->value = node->value;
+        copy->left = node->left;
+        node->left = copy;
+        *tail = copy;
+        tail = &copy->next;
+    }
+    *tail = NULL;
+
+    /* the copies are contiguous, clearing them again is a linear sweep */
+    for (node_t *copy = start; copy < obj->cur; copy++)
+        copy->left = NULL;
+    *old = *list;
+    *list = head;
+    return 0;
+}
+
+const char *node_pool_backing(node_pool_t obj)
+{
+    return obj->backing;
+}
+
+void node_pool_delete(node_pool_t obj)
+{
+    munmap(obj->map, obj->map_size);
+    free(obj);
+}
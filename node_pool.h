@@ -0,0 +1,50 @@
+/*
+ * Node pool: list nodes carved out of one anonymous mapping.
+ *
+ * Sorting a shuffled list chases pointers to pages in random order, so
+ * with 4 KB pages most of the misses also miss the dTLB. The pool can back
+ * the nodes with 2 MB pages: MAP_HUGETLB when the hugetlb pool has room,
+ * otherwise a 2 MB aligned mapping with madvise(MADV_HUGEPAGE) for
+ * transparent huge pages. NODE_POOL_4K asks for MADV_NOHUGEPAGE so the two
+ * can be compared on a THP "always" system too.
+ */
+
+#pragma once
+
+#include "list.h"
+
+typedef enum {
+    NODE_POOL_4K,
+    NODE_POOL_2M,
+} node_pool_page_t;
+
+typedef struct node_pool_internal *node_pool_t;
+
+/* Constructor, room for @nodes nodes, NULL if the mapping fails */
+node_pool_t node_pool_new(size_t nodes, node_pool_page_t page);
+
+/* Next unused node, NULL once the pool is full */
+node_t *node_pool_alloc(node_pool_t obj);
+
+/* What actually backs the pool: "hugetlb", "thp" or "4k" */
+const char *node_pool_backing(node_pool_t obj);
+
+/*
+ * Copy the nodes of *@list into the pool in list order so a later walk is
+ * sequential in memory, *@list becomes the copy. The original nodes are
+ * left linked as they were and each one's "left" field points at its copy
+ * (see node_pool_forward) until the caller frees them; *@old gets the
+ * original list. The copies have their tree fields cleared. Returns 0, or
+ * -1 if the pool runs out of room: then nothing is moved, *@list and
+ * every node's "left" are as they were and *@old is not touched.
+ */
+int node_pool_relocate(node_pool_t obj, node_t **list, node_t **old);
+
+/* Where a node handed to node_pool_relocate now lives */
+static inline node_t *node_pool_forward(const node_t *old)
+{
+    return old->left;
+}
+
+/* Destructor, unmaps every node handed out */
+void node_pool_delete(node_pool_t obj);
@@ -0,0 +1,77 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "perf_counter.h"
+
+struct perf_counter_internal {
+    int fd;
+};
+
+perf_counter_t perf_counter_new(uint32_t type, uint64_t config)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = 1;
+
+    int fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fd < 0)
+        return NULL;
+
+    perf_counter_t obj = malloc(sizeof(struct perf_counter_internal));
+    if (!obj) {
+        close(fd);
+        return NULL;
+    }
+    obj->fd = fd;
+    return obj;
+}
+
+void perf_counter_start(perf_counter_t obj)
+{
+    if (!obj)
+        return;
+    ioctl(obj->fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(obj->fd, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+void perf_counter_pause(perf_counter_t obj)
+{
+    if (obj)
+        ioctl(obj->fd, PERF_EVENT_IOC_DISABLE, 0);
+}
+
+void perf_counter_resume(perf_counter_t obj)
+{
+    if (obj)
+        ioctl(obj->fd, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+long long perf_counter_stop(perf_counter_t obj)
+{
+    long long count;
+
+    if (!obj)
+        return -1;
+    ioctl(obj->fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(obj->fd, &count, sizeof(count)) != sizeof(count))
+        return -1;
+    return count;
+}
+
+void perf_counter_delete(perf_counter_t obj)
+{
+    if (!obj)
+        return;
+    close(obj->fd);
+    free(obj);
+}
@@ -0,0 +1,31 @@
+/*
+ * Hardware event counters through perf_event_open(2), counting user space
+ * of the calling thread and of the threads it creates afterwards (their
+ * counts show up once they have exited).
+ *
+ * perf_counter_new returns NULL when the event cannot be opened (no PMU in
+ * a VM, perf_event_paranoid too high, ...), callers report -1 then.
+ */
+
+#pragma once
+
+#include <linux/perf_event.h>
+#include <stdint.h>
+
+typedef struct perf_counter_internal *perf_counter_t;
+
+/* Constructor, "type"/"config" as in struct perf_event_attr */
+perf_counter_t perf_counter_new(uint32_t type, uint64_t config);
+
+/* Zero the count and start counting */
+void perf_counter_start(perf_counter_t obj);
+
+/* Stop and go on counting without a reset, to count inside windows only */
+void perf_counter_pause(perf_counter_t obj);
+void perf_counter_resume(perf_counter_t obj);
+
+/* Stop counting, returns the events seen since start, -1 if obj is NULL */
+long long perf_counter_stop(perf_counter_t obj);
+
+/* Destructor, NULL is fine */
+void perf_counter_delete(perf_counter_t obj);
@@ -0,0 +1,291 @@
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "memprof.h"
+#include "snapshot.h"
+
+#define SNAPSHOT_MAGIC "LLSNAP01"
+#define VARINT_MAX 10   /* bytes of a 64-bit varint */
+
+struct snapshot_header {
+    char magic[8];
+    uint64_t count;
+    uint32_t block, nblocks;
+    uint64_t index_offset;
+};
+
+struct snapshot_index {
+    int64_t first;
+    uint64_t offset;
+};
+
+struct snapshot_internal {
+    const uint8_t *data;        /* whole file */
+    size_t size;
+    bool mapped;
+    struct snapshot_header header;
+    const struct snapshot_index *index;
+};
+
+static inline uint64_t zigzag(int64_t v)
+{
+    return ((uint64_t) v << 1) ^ (uint64_t) (v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v)
+{
+    return (int64_t) (v >> 1) ^ -(int64_t) (v & 1);
+}
+
+static inline uint8_t *put_varint(uint8_t *p, uint64_t v)
+{
+    while (v >= 0x80) {
+        *p++ = (uint8_t) v | 0x80;
+        v >>= 7;
+    }
+    *p++ = (uint8_t) v;
+    return p;
+}
+
+/* Next varint of [*p, end) into *v, false if it runs past end */
+static inline bool get_varint(const uint8_t **p, const uint8_t *end,
+                              uint64_t *v)
+{
+    uint64_t r = 0;
+    for (int shift = 0; *p < end && shift < 64; shift += 7) {
+        uint8_t b = *(*p)++;
+        r |= (uint64_t) (b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *v = r;
+            return true;
+        }
+    }
+    return false;
+}
+
+int snapshot_save(const char *path, const node_t *list)
+{
+    FILE *f = fopen(path, "wb");
+    struct snapshot_header header = {.block = SNAPSHOT_BLOCK};
+    struct snapshot_index *index = NULL;
+    size_t cap = 0;
+    uint8_t buf[SNAPSHOT_BLOCK * VARINT_MAX];
+    uint64_t offset = sizeof(header);
+
+    if (!f)
+        return -1;
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    if (fwrite(&header, sizeof(header), 1, f) != 1)
+        goto fail;
+
+    while (list) {
+        uint8_t *p = buf;
+        uint64_t prev = 0;
+        size_t i;
+
+        if (header.nblocks == cap) {
+            cap = cap ? cap * 2 : 64;
+            struct snapshot_index *grown = realloc(index, cap * sizeof(*index));
+            if (!grown)
+                goto fail;
+            index = grown;
+        }
+        index[header.nblocks++] = (struct snapshot_index){list->value, offset};
+
+        /* deltas wrap in unsigned arithmetic, zig-zag keeps small ones short */
+        for (i = 0; list && i < SNAPSHOT_BLOCK; i++, list = list->next) {
+            p = put_varint(p, zigzag((int64_t) ((uint64_t) list->value - prev)));
+            prev = (uint64_t) list->value;
+        }
+        header.count += i;
+        if (fwrite(buf, 1, p - buf, f) != (size_t) (p - buf))
+            goto fail;
+        offset += p - buf;
+    }
+
+    /* pad so the reader can use the index in place */
+    static const uint8_t zero[sizeof(*index)];
+    size_t pad = -offset % sizeof(*index);
+    if (fwrite(zero, 1, pad, f) != pad)
+        goto fail;
+    header.index_offset = offset + pad;
+    if (header.nblocks &&
+        fwrite(index, sizeof(*index), header.nblocks, f) != header.nblocks)
+        goto fail;
+    if (fseek(f, 0, SEEK_SET) || fwrite(&header, sizeof(header), 1, f) != 1)
+        goto fail;
+    free(index);
+    return fclose(f) ? -1 : 0;
+
+fail:
+    free(index);
+    fclose(f);
+    return -1;
+}
+
+static bool snapshot_check(snapshot_t obj)
+{
+    const struct snapshot_header *h = &obj->header;
+
+    if (obj->size < sizeof(*h))
+        return false;
+    memcpy(&obj->header, obj->data, sizeof(*h));
+    if (memcmp(h->magic, SNAPSHOT_MAGIC, sizeof(h->magic)) || !h->block ||
+        h->nblocks != (h->count + h->block - 1) / h->block ||
+        h->index_offset < sizeof(*h) || h->index_offset > obj->size ||
+        (obj->size - h->index_offset) / sizeof(*obj->index) != h->nblocks)
+        return false;
+
+    obj->index = (const void *) (obj->data + h->index_offset);
+    for (uint32_t b = 0; b < h->nblocks; b++) {
+        uint64_t end = b + 1 < h->nblocks ? obj->index[b + 1].offset
+                                          : h->index_offset;
+        if (obj->index[b].offset < sizeof(*h) || obj->index[b].offset >= end)
+            return false;
+    }
+    return true;
+}
+
+snapshot_t snapshot_open(const char *path, snapshot_io_t io)
+{
+    snapshot_t obj = calloc(1, sizeof(struct snapshot_internal));
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+
+    if (!obj || fd < 0 || fstat(fd, &st))
+        goto fail;
+    obj->size = st.st_size;
+
+    if (io == SNAPSHOT_MMAP && obj->size) {
+        void *map = mmap(NULL, obj->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED)
+            goto fail;
+        madvise(map, obj->size, MADV_SEQUENTIAL);
+        obj->data = map;
+        obj->mapped = true;
+    } else {
+        uint8_t *buf = malloc(obj->size ? obj->size : 1);
+        size_t got = 0;
+        obj->data = buf;
+        while (buf && got < obj->size) {
+            ssize_t r = read(fd, buf + got, obj->size - got);
+            if (r <= 0)
+                goto fail;
+            got += r;
+        }
+        if (!buf)
+            goto fail;
+    }
+    close(fd);
+
+    /* the index is read in place, its offset has to keep it aligned */
+    if (!snapshot_check(obj) ||
+        obj->header.index_offset % _Alignof(struct snapshot_index)) {
+        snapshot_close(obj);
+        return NULL;
+    }
+    return obj;
+
+fail:
+    if (fd >= 0)
+        close(fd);
+    snapshot_close(obj);
+    return NULL;
+}
+
+size_t snapshot_count(snapshot_t obj)
+{
+    return obj->header.count;
+}
+
+/*
+ * Decode blocks from @b on, appending the values in [lo, hi] at *tail.
+ * Stops at the first value above hi, so a full load passes LONG_MIN and
+ * LONG_MAX and a range load needs a sorted snapshot.
+ */
+static int snapshot_decode(snapshot_t obj, uint32_t b, long lo, long hi,
+                           node_pool_t pool, node_t **list)
+{
+    const struct snapshot_header *h = &obj->header;
+    node_t **tail = list;
+
+    *list = NULL;
+    for (; b < h->nblocks; b++) {
+        const uint8_t *p = obj->data + obj->index[b].offset;
+        const uint8_t *end = b + 1 < h->nblocks
+                                 ? obj->data + obj->index[b + 1].offset
+                                 : obj->data + h->index_offset;
+        uint64_t n = b + 1 < h->nblocks ? h->block
+                                        : h->count - (uint64_t) b * h->block;
+        uint64_t v = 0, delta;
+
+        if (obj->index[b].first > hi)
+            break;
+        for (; n; n--) {
+            if (!get_varint(&p, end, &delta))
+                goto fail;
+            v += (uint64_t) unzigzag(delta);
+            if ((long) v < lo)
+                continue;
+            if ((long) v > hi)
+                goto done;
+
+            node_t *node = pool ? node_pool_alloc(pool)
+                                : mem_malloc(sizeof(node_t));
+            if (!node)
+                goto fail;
+            node->value = (long) v;
+            *tail = node;
+            tail = &node->next;
+        }
+    }
+done:
+    *tail = NULL;
+    return 0;
+
+fail:
+    *tail = NULL;
+    if (!pool && *list)
+        list_free(list);
+    *list = NULL;
+    return -1;
+}
+
+int snapshot_load(snapshot_t obj, node_pool_t pool, node_t **list)
+{
+    return snapshot_decode(obj, 0, LONG_MIN, LONG_MAX, pool, list);
+}
+
+int snapshot_load_range(snapshot_t obj, long lo, long hi, node_pool_t pool,
+                        node_t **list)
+{
+    /* last block starting below lo, equal keys may spill across blocks */
+    uint32_t l = 0, r = obj->header.nblocks;
+    while (r - l > 1) {
+        uint32_t m = l + (r - l) / 2;
+        if (obj->index[m].first < lo)
+            l = m;
+        else
+            r = m;
+    }
+    return snapshot_decode(obj, l, lo, hi, pool, list);
+}
+
+void snapshot_close(snapshot_t obj)
+{
+    if (!obj)
+        return;
+    if (obj->mapped)
+        munmap((void *) obj->data, obj->size);
+    else
+        free((void *) obj->data);
+    free(obj);
+}
@@ -0,0 +1,62 @@
+/*
+ * Snapshot: a sorted list saved to a file and loaded back without sorting.
+ *
+ * Values are stored in blocks of SNAPSHOT_BLOCK: the first value of a
+ * block as a zig-zag varint, every following one as the zig-zag varint of
+ * its difference to the previous value. On a sorted list of nearby keys
+ * most deltas take one or two bytes instead of eight. A block index at the
+ * end of the file holds the first value and the file offset of every
+ * block, so a key range can be loaded by decoding only the blocks that
+ * overlap it.
+ *
+ *   header  "LLSNAP01" count block nblocks index_offset
+ *   blocks  varint values, each block starts at a fresh byte
+ *   index   nblocks x { first value, offset }, 8-byte aligned
+ *
+ * Integers in the header and the index are in host byte order, a snapshot
+ * is not meant to move between machines of different endianness.
+ */
+
+#pragma once
+
+#include "list.h"
+#include "node_pool.h"
+
+#define SNAPSHOT_BLOCK 256
+
+typedef enum {
+    SNAPSHOT_READ,      /* read the file into a heap buffer */
+    SNAPSHOT_MMAP,      /* map the file, decode straight from the page cache */
+} snapshot_io_t;
+
+typedef struct snapshot_internal *snapshot_t;
+
+/*
+ * Write the values of @list to @path in list order. The list does not have
+ * to be sorted, it only compresses worse. Returns 0 or -1 on error.
+ */
+int snapshot_save(const char *path, const node_t *list);
+
+/* Open a snapshot and check its header and index, NULL on error */
+snapshot_t snapshot_open(const char *path, snapshot_io_t io);
+
+/* Number of values in the snapshot */
+size_t snapshot_count(snapshot_t obj);
+
+/*
+ * Rebuild the list in one pass over the blocks, *@list gets the nodes in
+ * the saved order. Nodes come from @pool, or are malloc'ed if it is NULL
+ * (free them with list_free). Returns 0, or -1 if a block is corrupt or
+ * the pool is full; *@list is NULL then and malloc'ed nodes are freed.
+ */
+int snapshot_load(snapshot_t obj, node_pool_t pool, node_t **list);
+
+/*
+ * Same for the values in [@lo, @hi] only of a snapshot of a sorted list,
+ * using the block index to skip to the first block that can hold @lo.
+ */
+int snapshot_load_range(snapshot_t obj, long lo, long hi, node_pool_t pool,
+                        node_t **list);
+
+/* Destructor, the loaded lists stay valid */
+void snapshot_close(snapshot_t obj);
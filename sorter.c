@@ -0,0 +1,93 @@
+#include <stdlib.h>
+
+#include "sorter.h"
+#include "memprof.h"
+#include "stats.h"
+
+#define SORTER_BINS 64
+
+struct sorter_internal {
+    list_t run;                     /* current small run, sorted */
+    node_t *bin[SORTER_BINS];       /* bin[i]: SORTER_RUN << i nodes */
+    int max;                        /* highest bin ever used */
+};
+
+sorter_t sorter_new(void)
+{
+    sorter_t obj = mem_malloc(sizeof(struct sorter_internal));
+
+    list_init(&obj->run);
+    for (int i = 0; i < SORTER_BINS; i++)
+        obj->bin[i] = NULL;
+    obj->max = 0;
+
+    return obj;
+}
+
+/* Move the full run into the counter, carrying like a binary increment */
+static void sorter_carry(sorter_t obj)
+{
+    node_t *cur = obj->run.head;
+    int i;
+
+    /* list_merge takes ties from the bin, the older run */
+    for (i = 0; obj->bin[i]; i++) {
+        cur = list_merge(obj->bin[i], cur);
+        obj->bin[i] = NULL;
+    }
+    obj->bin[i] = cur;
+    if (i > obj->max)
+        obj->max = i;
+    list_init(&obj->run);
+}
+
+void sorter_push(sorter_t obj, node_t *node)
+{
+    list_t *run = &obj->run;
+
+    if (!run->tail || run->tail->value <= node->value) {
+        list_append(run, node);
+    } else {
+        /* Behind every equal key, keeps the push order */
+        node_t **link = &run->head;
+        while (STATS_INC(cmp), (*link)->value <= node->value)
+            link = &(*link)->next;
+        node->next = *link;
+        *link = node;
+        STATS_ADD(next_writes, 2);
+        run->length++;
+    }
+
+    if (run->length == SORTER_RUN)
+        sorter_carry(obj);
+}
+
+void sorter_push_batch(sorter_t obj, node_t *list)
+{
+    while (list) {
+        node_t *node = list;
+        list = list->next;
+        sorter_push(obj, node);
+    }
+}
+
+node_t *sorter_finish(sorter_t obj)
+{
+    node_t *result = obj->run.head;
+
+    /* Newest first: the run, then bins from small (recent) to large */
+    for (int i = 0; i <= obj->max; i++) {
+        if (obj->bin[i]) {
+            result = list_merge(obj->bin[i], result);
+            obj->bin[i] = NULL;
+        }
+    }
+    list_init(&obj->run);
+    obj->max = 0;
+    return result;
+}
+
+void sorter_delete(sorter_t obj)
+{
+    mem_free(obj);
+}
@@ -0,0 +1,36 @@
+/*
+ * Streaming sorter: push nodes while they arrive, get the sorted list at
+ * the end.
+ *
+ * Nodes are first insertion sorted into a small run (appending is O(1)
+ * when the input is already in order). A full run is merged into a
+ * binomial counter of runs: bin i holds a sorted run of SORTER_RUN * 2^i
+ * nodes and a carry merges two equal sized runs into the next bin. Most of
+ * the sort cost is therefore paid inside sorter_push, and sorter_finish
+ * only merges the at most log2(n / SORTER_RUN) pending runs.
+ *
+ * Stable: equal keys come out in push order.
+ */
+
+#pragma once
+
+#include "list.h"
+
+#define SORTER_RUN 16
+
+typedef struct sorter_internal *sorter_t;
+
+/* Constructor */
+sorter_t sorter_new(void);
+
+/* Add one node, its "next" is overwritten */
+void sorter_push(sorter_t obj, node_t *node);
+
+/* Add every node of a NULL terminated list */
+void sorter_push_batch(sorter_t obj, node_t *list);
+
+/* Sorted list of everything pushed so far, the sorter is empty afterwards */
+node_t *sorter_finish(sorter_t obj);
+
+/* Destructor, pending nodes are not freed */
+void sorter_delete(sorter_t obj);
@@ -0,0 +1,66 @@
+/*
+ * Algorithm counters, compiled in with -DSORT_STATS.
+ *
+ * Without SORT_STATS every macro expands to nothing, so the engines build
+ * exactly as before. STATS_INC and STATS_ADD are expressions and may sit
+ * inside a loop condition. With it, a single global struct is updated (not
+ * thread safe) and the driver reports it per run in CSV mode. The global
+ * is defined in list.c.
+ */
+
+#pragma once
+
+#define STATS_IMBALANCE_BUCKETS 10
+
+#ifdef SORT_STATS
+
+struct sort_stats {
+    unsigned long cmp;              /* key comparisons */
+    unsigned long next_writes;      /* stores to a "next" field */
+    unsigned long depth, max_depth; /* recursion depth now / reached */
+    unsigned long tree_fallbacks;   /* introsort ran out of max_level */
+    unsigned long insert_leaves;    /* insertion sorted sublists */
+    unsigned long rotations;        /* c_map rotations */
+    unsigned long recolors;         /* c_map_fix_colors color changes */
+    /* partitions by min(left, right) / (left + right), 0.05 per bucket */
+    unsigned long imbalance[STATS_IMBALANCE_BUCKETS];
+};
+
+extern struct sort_stats sort_stats;
+
+#define STATS_INC(field) (sort_stats.field++)
+#define STATS_ADD(field, n) (sort_stats.field += (n))
+#define STATS_ENTER()                                      \
+    do {                                                   \
+        if (++sort_stats.depth > sort_stats.max_depth)     \
+            sort_stats.max_depth = sort_stats.depth;       \
+    } while (0)
+#define STATS_LEAVE() (sort_stats.depth--)
+#define STATS_DEPTH(d)                                     \
+    do {                                                   \
+        if ((unsigned long) (d) > sort_stats.max_depth)    \
+            sort_stats.max_depth = (d);                    \
+    } while (0)
+#define STATS_PARTITION(l, r)                                               \
+    do {                                                                    \
+        size_t __l = (l), __r = (r), __min = __l < __r ? __l : __r;         \
+        if (__l + __r) {                                                    \
+            size_t __b = __min * 2 * STATS_IMBALANCE_BUCKETS / (__l + __r); \
+            if (__b >= STATS_IMBALANCE_BUCKETS)                             \
+                __b = STATS_IMBALANCE_BUCKETS - 1;                          \
+            sort_stats.imbalance[__b]++;                                    \
+        }                                                                   \
+    } while (0)
+#define STATS_RESET() memset(&sort_stats, 0, sizeof(sort_stats))
+
+#else
+
+#define STATS_INC(field) ((void) 0)
+#define STATS_ADD(field, n) ((void) 0)
+#define STATS_ENTER() do { } while (0)
+#define STATS_LEAVE() ((void) 0)
+#define STATS_DEPTH(d) do { } while (0)
+#define STATS_PARTITION(l, r) do { } while (0)
+#define STATS_RESET() do { } while (0)
+
+#endif
@@ -0,0 +1,283 @@
+#include <endian.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "strsort.h"
+#include "memprof.h"
+
+/* Below this many nodes the remaining suffixes are insertion sorted */
+#define STR_INSERT_THRESHOLD 12
+
+/* Evenly spaced pivot candidates kept per list, see str_sample_add */
+#define STR_SAMPLE_MAX 16
+
+typedef struct {
+    str_node_t *head, *tail;
+    size_t length;
+} str_list_t;
+
+/*
+ * Pivot candidates collected while a list is built, like the node_t quick
+ * sort does: every (mask + 1)-th node is kept, and once the array is full
+ * every other one is dropped and the stride doubles, so the samples stay
+ * spread over the whole list.
+ */
+typedef struct {
+    str_node_t *node[STR_SAMPLE_MAX];
+    size_t seen, count, mask;
+} str_sample_t;
+
+static inline void str_sample_init(str_sample_t *s)
+{
+    s->seen = s->count = s->mask = 0;
+}
+
+static inline void str_sample_add(str_sample_t *s, str_node_t *n)
+{
+    size_t i = s->seen++;
+
+    if (i & s->mask)
+        return;
+    if (s->count == STR_SAMPLE_MAX) {
+        for (size_t k = 0; k < STR_SAMPLE_MAX / 2; k++)
+            s->node[k] = s->node[2 * k];
+        s->count = STR_SAMPLE_MAX / 2;
+        s->mask = (s->mask << 1) | 1;
+        if (i & s->mask)
+            return;
+    }
+    s->node[s->count++] = n;
+}
+
+static inline void str_list_init(str_list_t *list)
+{
+    list->head = list->tail = NULL;
+    list->length = 0;
+}
+
+static inline void str_list_append(str_list_t *list, str_node_t *node)
+{
+    node->next = NULL;
+    if (list->tail)
+        list->tail->next = node;
+    else
+        list->head = node;
+    list->tail = node;
+    list->length++;
+}
+
+static inline void str_list_join(str_list_t *left, str_list_t *right)
+{
+    if (!right->head)
+        return;
+    if (left->tail)
+        left->tail->next = right->head;
+    else
+        left->head = right->head;
+    left->tail = right->tail;
+    left->length += right->length;
+}
+
+void str_node_init(str_node_t *node, const char *key, size_t len)
+{
+    uint64_t prefix = 0;
+
+    for (size_t i = 0; i < 8; i++)
+        prefix = (prefix << 8) | (i < len ? (unsigned char) key[i] : 0);
+    node->prefix = prefix;
+    node->key = key;
+    node->len = len;
+    node->next = NULL;
+}
+
+str_node_t *str_list_make_node(str_node_t *list, const char *key, size_t len)
+{
+    str_node_t *node = mem_malloc(sizeof(str_node_t));
+    str_node_init(node, key, len);
+    node->next = list;
+    return node;
+}
+
+void str_list_free(str_node_t **list)
+{
+    while (*list) {
+        str_node_t *next = (*list)->next;
+        mem_free(*list);
+        *list = next;
+    }
+}
+
+/*
+ * The sort works on 8-byte characters: the big-endian word of the key at
+ * depth d, plus how many of those 8 bytes the key really has. Comparing the
+ * pair (word, clip) orders keys exactly like byte-wise compare with length
+ * as the tie break. Depth 0 is the cached prefix, deeper words are loaded
+ * from the key.
+ */
+static inline uint64_t str_word_at(const str_node_t *node, size_t d)
+{
+    if (d == 0)
+        return node->prefix;
+
+    size_t rest = node->len > d ? node->len - d : 0;
+    if (rest >= 8) {
+        uint64_t w;
+        memcpy(&w, node->key + d, 8);
+        return be64toh(w);
+    }
+
+    uint64_t w = 0;
+    for (size_t i = 0; i < 8; i++)
+        w = (w << 8) | (i < rest ? (unsigned char) node->key[d + i] : 0);
+    return w;
+}
+
+static inline unsigned str_clip_at(const str_node_t *node, size_t d)
+{
+    size_t rest = node->len > d ? node->len - d : 0;
+    return rest < 8 ? rest : 8;
+}
+
+/* Order of a and b on the word at depth d */
+static inline int str_char_cmp(const str_node_t *a, const str_node_t *b,
+                               size_t d)
+{
+    uint64_t wa = str_word_at(a, d), wb = str_word_at(b, d);
+    unsigned la = str_clip_at(a, d), lb = str_clip_at(b, d);
+
+    if (wa != wb)
+        return wa < wb ? -1 : 1;
+    return (la > lb) - (la < lb);
+}
+
+/*
+ * Median of the first, middle and last sample on the word at depth d, so
+ * sorted or reversed input still splits in halves instead of peeling one
+ * key per pass as a head pivot does.
+ */
+static str_node_t *str_pivot(str_sample_t *s, size_t d)
+{
+    str_node_t *a = s->node[0], *b = s->node[s->count / 2];
+    str_node_t *c = s->node[s->count - 1];
+
+    if (s->count < 3)
+        return a;
+    if (str_char_cmp(a, b, d) < 0) {
+        if (str_char_cmp(b, c, d) < 0)
+            return b;
+        return str_char_cmp(a, c, d) < 0 ? c : a;
+    }
+    if (str_char_cmp(a, c, d) < 0)
+        return a;
+    return str_char_cmp(b, c, d) < 0 ? c : b;
+}
+
+/* Compare from depth d on, everything before d is known to be equal */
+static int str_cmp_from(const str_node_t *a, const str_node_t *b, size_t d)
+{
+    if (d < 8 && a->prefix != b->prefix)
+        return a->prefix < b->prefix ? -1 : 1;
+    if (d < 8)
+        d = 8;
+
+    size_t n = a->len < b->len ? a->len : b->len;
+    if (d < n) {
+        int res = memcmp(a->key + d, b->key + d, n - d);
+        if (res)
+            return res;
+    }
+    return (a->len > b->len) - (a->len < b->len);
+}
+
+int str_node_cmp(const str_node_t *a, const str_node_t *b)
+{
+    return str_cmp_from(a, b, 0);
+}
+
+static void str_insertsort(str_list_t *list, size_t d)
+{
+    str_node_t *sorted = NULL, *tail = NULL, *cur = list->head;
+
+    while (cur) {
+        str_node_t *node = cur, **link = &sorted;
+        cur = cur->next;
+
+        while (*link && str_cmp_from(*link, node, d) <= 0)
+            link = &(*link)->next;
+        node->next = *link;
+        *link = node;
+        if (!node->next)
+            tail = node;
+    }
+    list->head = sorted;
+    list->tail = tail;
+}
+
+/*
+ * All nodes share their first d bytes, d is a multiple of 8. s holds the
+ * pivot candidates sampled while the list was built.
+ */
+static void str_mkqsort_list(str_list_t *list, str_sample_t *s, size_t d)
+{
+    if (list->length < STR_INSERT_THRESHOLD) {
+        str_insertsort(list, d);
+        return;
+    }
+
+    str_list_t less, equal, greater;
+    str_sample_t sless, sequal, sgreater;
+    str_node_t *p = str_pivot(s, d);
+    uint64_t pw = str_word_at(p, d);
+    unsigned pl = str_clip_at(p, d);
+
+    str_list_init(&less);
+    str_list_init(&equal);
+    str_list_init(&greater);
+    str_sample_init(&sless);
+    str_sample_init(&sequal);
+    str_sample_init(&sgreater);
+    for (p = list->head; p; ) {
+        str_node_t *n = p;
+        uint64_t w = str_word_at(n, d);
+        unsigned l = str_clip_at(n, d);
+        p = p->next;
+        if (w < pw || (w == pw && l < pl)) {
+            str_list_append(&less, n);
+            str_sample_add(&sless, n);
+        } else if (w > pw || l > pl) {
+            str_list_append(&greater, n);
+            str_sample_add(&sgreater, n);
+        } else {
+            str_list_append(&equal, n);
+            str_sample_add(&sequal, n);
+        }
+    }
+
+    str_mkqsort_list(&less, &sless, d);
+    str_mkqsort_list(&greater, &sgreater, d);
+
+    /* Keys ending inside this word are all equal, otherwise go deeper */
+    if (pl == 8 && equal.length > 1)
+        str_mkqsort_list(&equal, &sequal, d + 8);
+
+    str_list_init(list);
+    str_list_join(list, &less);
+    str_list_join(list, &equal);
+    str_list_join(list, &greater);
+}
+
+void str_mkqsort(str_node_t **list)
+{
+    str_list_t l;
+    str_sample_t s;
+
+    str_list_init(&l);
+    str_sample_init(&s);
+    for (str_node_t *n = *list; n; n = n->next) {
+        str_sample_add(&s, n);
+        l.length++;
+    }
+    l.head = *list;
+    str_mkqsort_list(&l, &s, 0);
+    *list = l.head;
+}
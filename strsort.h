@@ -0,0 +1,36 @@
+/*
+ * String key list and multikey quick sort.
+ *
+ * A str_node_t points at its key instead of holding it, and caches the
+ * first 8 bytes as a big-endian integer. The sort is a multikey quick sort
+ * whose "character" is an 8-byte word: each pass splits into less / equal /
+ * greater on one word, and only the equal part moves on to the next word.
+ * The first word comes out of the cached prefix, so only nodes that share
+ * a prefix of 8 bytes or more ever dereference their key.
+ *
+ * Keys are compared as unsigned bytes with the length deciding between a
+ * string and its own prefix, like memcmp followed by a length compare. The
+ * key memory is owned by the caller.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct __str_node {
+    uint64_t prefix;
+    const char *key;
+    size_t len;
+    struct __str_node *next;
+} str_node_t;
+
+void str_node_init(str_node_t *node, const char *key, size_t len);
+str_node_t *str_list_make_node(str_node_t *list, const char *key, size_t len);
+void str_list_free(str_node_t **list);
+
+/* Compare two keys, <0, 0 or >0 */
+int str_node_cmp(const str_node_t *a, const str_node_t *b);
+
+/* Multikey quick sort, not stable */
+void str_mkqsort(str_node_t **list);
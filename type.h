@@ -35,6 +35,18 @@ struct c_map_internal {
 };
 
 
+#ifdef C_MAP_PLAIN
+/* Layout for c_map.c: explicit parent pointer and color field */
+typedef enum { C_MAP_RED, C_MAP_BLACK, C_MAP_DOUBLE_BLACK } c_map_color_t;
+
+typedef struct __node {
+    struct __node *left, *right, *up;
+    c_map_color_t color;
+    struct __node *next;
+    long value;
+} node_t;
+#else
+/* Layout for c_map_bit.c: color packed into the parent pointer */
 typedef struct __node { 
     unsigned long  color;
     struct __node *left;
@@ -52,3 +64,4 @@ typedef struct __node {
 #define rb_set_black(r)  do { (r)->color |= 1; } while (0)
 #define rb_is_red(r)      (!rb_color(r))
 #define rb_is_black(r)    (rb_color(r))
+#endif
@@ -0,0 +1,209 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#include "ulist.h"
+#include "memprof.h"
+#include "stats.h"
+
+#define ULIST_BINS 64
+
+static ulist_block_t *ulist_block_new(void)
+{
+    ulist_block_t *block = mem_malloc(sizeof(ulist_block_t));
+    assert(block);
+    block->next = NULL;
+    block->count = 0;
+    return block;
+}
+
+void ulist_push(ulist_t *ul, long value)
+{
+    ulist_block_t *tail = ul->tail;
+
+    if (!tail || tail->count == ULIST_VALUES) {
+        tail = ulist_block_new();
+        if (ul->tail)
+            ul->tail->next = tail;
+        else
+            ul->head = tail;
+        ul->tail = tail;
+    }
+    tail->value[tail->count++] = value;
+    ul->length++;
+}
+
+void ulist_from_list(ulist_t *ul, const node_t *list)
+{
+    ulist_init(ul);
+    for (; list; list = list->next)
+        ulist_push(ul, list->value);
+}
+
+void ulist_to_list(const ulist_t *ul, node_t *list)
+{
+    for (ulist_block_t *block = ul->head; block; block = block->next)
+        for (size_t i = 0; i < block->count; i++) {
+            assert(list);
+            list->value = block->value[i];
+            list = list->next;
+        }
+}
+
+/* In-block insertion sort, at most ULIST_VALUES keys in one line */
+static void ulist_block_sort(ulist_block_t *block)
+{
+    long *v = block->value;
+
+    for (size_t i = 1; i < block->count; i++) {
+        long key = v[i];
+        size_t j = i;
+        while (j > 0 && (STATS_INC(cmp), v[j - 1] > key)) {
+            v[j] = v[j - 1];
+            j--;
+        }
+        v[j] = key;
+    }
+}
+
+/*
+ * Spent input blocks go on a spare chain and are reused for the output,
+ * so merging needs at most two blocks on top of its inputs.
+ */
+static ulist_block_t *ulist_spare_get(ulist_block_t **spare)
+{
+    ulist_block_t *block = *spare;
+
+    if (!block)
+        return ulist_block_new();
+    *spare = block->next;
+    block->next = NULL;
+    block->count = 0;
+    return block;
+}
+
+static void ulist_spare_put(ulist_block_t **spare, ulist_block_t *block)
+{
+    block->next = *spare;
+    *spare = block;
+}
+
+/* Append one key to @out, taking a new tail block from @spare if needed */
+static inline void ulist_emit(ulist_t *out, long value, ulist_block_t **spare)
+{
+    ulist_block_t *tail = out->tail;
+
+    if (!tail || tail->count == ULIST_VALUES) {
+        tail = ulist_spare_get(spare);
+        if (out->tail)
+            out->tail->next = tail;
+        else
+            out->head = tail;
+        out->tail = tail;
+    }
+    tail->value[tail->count++] = value;
+    out->length++;
+}
+
+/* Stable merge of two sorted lists, ties are taken from @a */
+static ulist_t ulist_merge(ulist_t *a, ulist_t *b, ulist_block_t **spare)
+{
+    ulist_t out;
+    ulist_block_t *ba = a->head, *bb = b->head;
+    size_t ia = 0, ib = 0, taken = 0;  /* taken: keys emitted from @a */
+
+    ulist_init(&out);
+    while (ba && bb) {
+        STATS_INC(cmp);
+        if (ba->value[ia] <= bb->value[ib]) {
+            ulist_emit(&out, ba->value[ia], spare);
+            taken++;
+            if (++ia == ba->count) {
+                ulist_block_t *next = ba->next;
+                ulist_spare_put(spare, ba);
+                ba = next;
+                ia = 0;
+            }
+        } else {
+            ulist_emit(&out, bb->value[ib], spare);
+            if (++ib == bb->count) {
+                ulist_block_t *next = bb->next;
+                ulist_spare_put(spare, bb);
+                bb = next;
+                ib = 0;
+            }
+        }
+    }
+
+    /* Finish the partly read block, then splice the untouched ones */
+    ulist_t rest = ba ? *a : *b;
+    ulist_block_t *block = ba ? ba : bb;
+    size_t i = ba ? ia : ib;
+    rest.length -= ba ? taken : out.length - taken;
+    if (block && i) {
+        while (i < block->count) {
+            ulist_emit(&out, block->value[i++], spare);
+            rest.length--;
+        }
+        ulist_block_t *next = block->next;
+        ulist_spare_put(spare, block);
+        block = next;
+    }
+    if (block) {
+        rest.head = block;
+        ulist_join(&out, &rest);
+    }
+    ulist_init(a);
+    ulist_init(b);
+    return out;
+}
+
+void ulist_sort(ulist_t *ul)
+{
+    ulist_t bin[ULIST_BINS];
+    ulist_block_t *spare = NULL, *block = ul->head;
+    int max = 0;
+
+    for (int i = 0; i < ULIST_BINS; i++)
+        ulist_init(&bin[i]);
+
+    /* Every sorted block is a run, merged in like a binary increment */
+    while (block) {
+        ulist_t cur = { block, block, block->count };
+        ulist_block_t *next = block->next;
+        int i;
+
+        block->next = NULL;
+        ulist_block_sort(block);
+        for (i = 0; bin[i].head; i++)
+            cur = ulist_merge(&bin[i], &cur, &spare);
+        bin[i] = cur;
+        if (i > max)
+            max = i;
+        block = next;
+    }
+
+    ulist_t out;
+    ulist_init(&out);
+    for (int i = 0; i <= max; i++)
+        if (bin[i].head)
+            out = out.head ? ulist_merge(&bin[i], &out, &spare) : bin[i];
+
+    while (spare) {
+        ulist_block_t *next = spare->next;
+        mem_free(spare);
+        spare = next;
+    }
+    *ul = out;
+}
+
+void ulist_free(ulist_t *ul)
+{
+    ulist_block_t *block = ul->head;
+
+    while (block) {
+        ulist_block_t *next = block->next;
+        mem_free(block);
+        block = next;
+    }
+    ulist_init(ul);
+}